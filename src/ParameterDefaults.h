@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+
+// defaults of the plugin parameters, shared by the parameter layout and the PingRender CLI; kept out of the
+// generated PingsynthConstants.h so a regeneration does not drop them
+namespace ParameterDefaults
+{
+struct Default
+{
+    std::string_view id;
+    float value;
+};
+
+constexpr std::array<Default, 17> Defaults{{
+    {"vol", 0.f},
+    {"reverbLevel", -24.f},
+    {"user1", 0.f},
+    {"user10", 0.f},
+    {"user2", 0.f},
+    {"user3", 0.f},
+    {"user5", 0.f},
+    {"user4", 0.f},
+    {"user6", 0.f},
+    {"user7", 0.f},
+    {"user8", 0.f},
+    {"user9", 0.f},
+    {"user11", 0.f},
+    {"user12", 0.f},
+    {"user13", 0.f},
+    {"user14", 5.f},
+    {"user15", 10.f},
+}};
+
+// the default of parameter id, a compile error in constant evaluation when there is none
+consteval float defaultOf(const std::string_view id)
+{
+    for (const auto& entry : Defaults)
+    {
+        if (entry.id == id)
+        {
+            return entry.value;
+        }
+    }
+    throw "unknown parameter id";
+}
+} // namespace ParameterDefaults
@@ -10,6 +10,8 @@
 
 #include "Audio/FixedSizeProcessor.h"
 
+#include "ParameterDefaults.h"
+#include "PingsynthConstants.h"
 #include "UiElements.h"
 
 #include "impl/PingSynthExplorerPedal.h"
@@ -62,8 +64,10 @@ class AudioPluginAudioProcessor : public juce::AudioProcessor, public juce::Audi
 
     void prepareToPlay(double sampleRate, int samplesPerBlock) override
     {
-        pluginRunner = std::make_unique<PingSynthExplorerPedal<NumSamplesPerBlock>>(static_cast<float>(sampleRate));
+        pluginRunner = std::make_unique<PingSynthExplorerPedal<NumSamplesPerBlock>>(
+            static_cast<float>(sampleRate), static_cast<size_t>(std::max(samplesPerBlock, 1)));
         m_sampleRate = static_cast<size_t>(sampleRate);
+        m_renderedSamples = 0;
         for (auto* param : getParameters())
         {
             if (auto* p = dynamic_cast<juce::RangedAudioParameter*>(param))
@@ -76,8 +80,6 @@ class AudioPluginAudioProcessor : public juce::AudioProcessor, public juce::Audi
         {
             m_parameters.replaceState(m_newState);
         }
-
-        juce::ignoreUnused(samplesPerBlock);
     }
 
     void releaseResources() override
@@ -220,74 +222,75 @@ class AudioPluginAudioProcessor : public juce::AudioProcessor, public juce::Audi
 #pragma GCC diagnostic ignored "-Wimplicit-float-conversion"
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
     {
+        using ParameterDefaults::defaultOf;
         std::vector<std::unique_ptr<juce::RangedAudioParameter>> params;
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("vol", 1), "Vol", juce::NormalisableRange<float>(-100, 12, 0.1, 1, false), 0,
-            juce::String("Vol"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("vol", 1), "Vol", juce::NormalisableRange<float>(-100, 12, 0.1, 1, false),
+            defaultOf("vol"), juce::String("Vol"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " dB"; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("reverbLevel", 1), "Reverb", juce::NormalisableRange<float>(-120, 0, 1, 1, false), -24,
-            juce::String("Reverb"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("reverbLevel", 1), "Reverb", juce::NormalisableRange<float>(-120, 0, 1, 1, false),
+            defaultOf("reverbLevel"), juce::String("Reverb"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 0) + " dB"; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("user1", 1), "Decay", juce::NormalisableRange<float>(0, 100, 0.1, 1, false), 0,
-            juce::String("Decay"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("user1", 1), "Decay", juce::NormalisableRange<float>(0, 100, 0.1, 1, false),
+            defaultOf("user1"), juce::String("Decay"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " %"; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("user10", 1), "Decay Skew", juce::NormalisableRange<float>(-100, 100, 0.1, 1, false), 0,
-            juce::String("Decay Skew"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("user10", 1), "Decay Skew", juce::NormalisableRange<float>(-100, 100, 0.1, 1, false),
+            defaultOf("user10"), juce::String("Decay Skew"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " %"; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("user2", 1), "Spread", juce::NormalisableRange<float>(0, 100, 0.1, 1, false), 0,
-            juce::String("Spread"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("user2", 1), "Spread", juce::NormalisableRange<float>(0, 100, 0.1, 1, false),
+            defaultOf("user2"), juce::String("Spread"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " %"; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("user3", 1), "Odds", juce::NormalisableRange<float>(0, 100, 0.1, 1, false), 0,
-            juce::String("Odds"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("user3", 1), "Odds", juce::NormalisableRange<float>(0, 100, 0.1, 1, false),
+            defaultOf("user3"), juce::String("Odds"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " %"; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("user5", 1), "Odds Skew", juce::NormalisableRange<float>(-100, 100, 0.1, 1, false), 0,
-            juce::String("Odds Skew"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("user5", 1), "Odds Skew", juce::NormalisableRange<float>(-100, 100, 0.1, 1, false),
+            defaultOf("user5"), juce::String("Odds Skew"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " %"; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("user4", 1), "Evens", juce::NormalisableRange<float>(0, 100, 0.1, 1, false), 0,
-            juce::String("Evens"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("user4", 1), "Evens", juce::NormalisableRange<float>(0, 100, 0.1, 1, false),
+            defaultOf("user4"), juce::String("Evens"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " %"; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("user6", 1), "Evens Skew", juce::NormalisableRange<float>(-100, 100, 0.1, 1, false), 0,
-            juce::String("Evens Skew"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("user6", 1), "Evens Skew", juce::NormalisableRange<float>(-100, 100, 0.1, 1, false),
+            defaultOf("user6"), juce::String("Evens Skew"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " %"; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("user7", 1), "Piano Stretch", juce::NormalisableRange<float>(0, 100, 0.1, 1, false), 0,
-            juce::String("Piano Stretch"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("user7", 1), "Piano Stretch", juce::NormalisableRange<float>(0, 100, 0.1, 1, false),
+            defaultOf("user7"), juce::String("Piano Stretch"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " %"; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("user8", 1), "Rand Spread", juce::NormalisableRange<float>(0, 100, 0.1, 1, false), 0,
-            juce::String("Rand Spread"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("user8", 1), "Rand Spread", juce::NormalisableRange<float>(0, 100, 0.1, 1, false),
+            defaultOf("user8"), juce::String("Rand Spread"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " %"; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("user9", 1), "Rand Power", juce::NormalisableRange<float>(0, 100, 0.1, 1, false), 0,
-            juce::String("Rand Power"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("user9", 1), "Rand Power", juce::NormalisableRange<float>(0, 100, 0.1, 1, false),
+            defaultOf("user9"), juce::String("Rand Power"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " %"; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("user11", 1), "Rand Excitation", juce::NormalisableRange<float>(0, 100, 0.1, 1, false), 0,
-            juce::String("Rand Excitation"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("user11", 1), "Rand Excitation", juce::NormalisableRange<float>(0, 100, 0.1, 1, false),
+            defaultOf("user11"), juce::String("Rand Excitation"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " %"; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
             juce::ParameterID("user12", 1), "Sparkle Time", juce::NormalisableRange<float>(-1000, 1000, 0.1, 1, false),
-            0, juce::String("Sparkle Time"), juce::AudioProcessorParameter::genericParameter,
+            defaultOf("user12"), juce::String("Sparkle Time"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " ms"; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("user13", 1), "Sparkle Rand", juce::NormalisableRange<float>(0, 100, 0.1, 1, false), 0,
-            juce::String("Sparkle Rand"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("user13", 1), "Sparkle Rand", juce::NormalisableRange<float>(0, 100, 0.1, 1, false),
+            defaultOf("user13"), juce::String("Sparkle Rand"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " %"; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("user14", 1), "Min Overtones", juce::NormalisableRange<float>(1, 100, 1, 1, false), 5,
-            juce::String("Min Overtones"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("user14", 1), "Min Overtones", juce::NormalisableRange<float>(1, 100, 1, 1, false),
+            defaultOf("user14"), juce::String("Min Overtones"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " "; }));
         params.push_back(std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("user15", 1), "Max Overtones", juce::NormalisableRange<float>(1, 100, 1, 1, false), 10,
-            juce::String("Max Overtones"), juce::AudioProcessorParameter::genericParameter,
+            juce::ParameterID("user15", 1), "Max Overtones", juce::NormalisableRange<float>(1, 100, 1, 1, false),
+            defaultOf("user15"), juce::String("Max Overtones"), juce::AudioProcessorParameter::genericParameter,
             [](float value, float) { return juce::String(value, 1) + " "; }));
 
         return {params.begin(), params.end()};
@@ -357,7 +360,8 @@ class AudioPluginAudioProcessor : public juce::AudioProcessor, public juce::Audi
         {
             for (const auto& msg : midiMessages)
             {
-                pluginRunner->processMidi(msg.data);
+                pluginRunner->scheduleMidi(msg.data, static_cast<size_t>(msg.numBytes),
+                                           m_renderedSamples + static_cast<uint64_t>(msg.samplePosition));
             }
         }
         for (int c = 0; c < std::min(2, buffer.getNumChannels()); ++c)
@@ -374,6 +378,7 @@ class AudioPluginAudioProcessor : public juce::AudioProcessor, public juce::Audi
             m_envOutput[c].feed(buffer.getReadPointer(c), buffer.getNumSamples());
             m_outputDb[c].store(std::log10(m_envOutput[c].getRms()) * 20.f);
         }
+        m_renderedSamples += static_cast<uint64_t>(buffer.getNumSamples());
         m_spectrogram.processBlock(buffer.getWritePointer(0), buffer.getNumSamples());
         const auto endTime = std::chrono::high_resolution_clock::now();
         computeCpuLoad(std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - beginTime),
@@ -407,6 +412,7 @@ class AudioPluginAudioProcessor : public juce::AudioProcessor, public juce::Audi
 
   private:
     size_t m_sampleRate{48000};
+    uint64_t m_renderedSamples{0};
 
     static bool isChanged(const float a, const float b)
     {
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+// same slot layout as PingSynth
+namespace BenchConfig
+{
+constexpr size_t BlockSize{16};
+constexpr float SampleRate{48000.f};
+constexpr int MinMidiNote{17};
+constexpr int MaxMidiNote{132};
+constexpr int StepsPerSemitone{66};
+constexpr size_t NumElements{(MaxMidiNote - MinMidiNote) * StepsPerSemitone + 1};
+}
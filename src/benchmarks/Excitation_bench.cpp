@@ -0,0 +1,81 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+
+#include "BenchConfig.h"
+#include "impl/ExcitationBursts.h"
+#include "impl/PingExcitation.h"
+
+using namespace BenchConfig;
+
+// one block of excitation per call, restarting the burst when it runs out
+static void BM_ExcitationRenderBlock(benchmark::State& state)
+{
+    Excitation excitation(1024);
+    excitation.setNoise(static_cast<float>(state.range(0)) * 0.01f);
+    constexpr float advance = 0.37f;
+    float position = 1023.f;
+    uint32_t noiseCursor = Excitation::noiseStart(0);
+    float out[BlockSize]{};
+    for (auto _ : state)
+    {
+        excitation.render(out, 1, BlockSize, position, advance, 1.f, noiseCursor);
+        benchmark::DoNotOptimize(out);
+        if (position <= 0.f)
+        {
+            position += 1023.f;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * BlockSize));
+}
+BENCHMARK(BM_ExcitationRenderBlock)->ArgName("noise%")->Arg(0)->Arg(50);
+
+// the same block served from a pre-rendered burst
+static void BM_ExcitationBurstBlock(benchmark::State& state)
+{
+    Excitation excitation(1024);
+    ExcitationBursts<NumElements> bursts(excitation);
+    bursts.setCapacity(1 << 20);
+    constexpr float advance = 0.37f;
+    std::array<float, NumElements> advances;
+    advances.fill(advance);
+    bursts.prepareAll(advances);
+    float position = 1023.f;
+    uint32_t noiseCursor = Excitation::noiseStart(0);
+    float out[BlockSize]{};
+    for (auto _ : state)
+    {
+        bursts.render(0, out, 1, BlockSize, position, advance, 1.f, noiseCursor);
+        benchmark::DoNotOptimize(out);
+        if (position <= 0.f)
+        {
+            position = 1023.f;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * BlockSize));
+}
+BENCHMARK(BM_ExcitationBurstBlock);
+
+// one block per call for each shape, noise off
+static void BM_ExcitationShapeBlock(benchmark::State& state)
+{
+    Excitation excitation(1024);
+    excitation.setShape(static_cast<ExcitationShape>(state.range(0)));
+    constexpr float advance = 0.37f;
+    float position = 1023.f;
+    uint32_t noiseCursor = Excitation::noiseStart(0);
+    float out[BlockSize]{};
+    int64_t samples = 0;
+    for (auto _ : state)
+    {
+        samples += static_cast<int64_t>(
+            excitation.render(out, 1, BlockSize, position, advance, 1.f, noiseCursor));
+        benchmark::DoNotOptimize(out);
+        if (position <= 0.f)
+        {
+            position = 1023.f;
+        }
+    }
+    state.SetItemsProcessed(samples);
+}
+BENCHMARK(BM_ExcitationShapeBlock)->ArgName("shape")->DenseRange(0, 5);
@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <memory>
+
+#include "BenchConfig.h"
+#include "impl/PingSynth.h"
+
+using namespace BenchConfig;
+
+// one chord per iteration with every generator at full overtone count, rendering that drains the trigger
+// queue between chords is excluded from the timing
+static void BM_PingSynthTriggerStorm(benchmark::State& state)
+{
+    const auto notesPerChord = static_cast<size_t>(state.range(0));
+    auto synth = std::make_unique<PingSynth<BlockSize>>(SampleRate);
+    synth->setOddsOvertones(1.f);
+    synth->setEvenOvertones(1.f);
+    synth->setStretchedOvertones(1.f);
+    synth->setSpread(0.75f);
+    synth->setRandomPower(0.5f);
+    synth->setRandomSpread(0.5f);
+    synth->setMinOvertones(100);
+    synth->setMaxOvertones(100);
+
+    std::array<float, BlockSize> out{};
+    size_t note = 24;
+    for (auto _ : state)
+    {
+        for (size_t n = 0; n < notesPerChord; ++n)
+        {
+            synth->triggerVoice(note, 1.f);
+            note = note >= 96 ? 24 : note + 5;
+        }
+        state.PauseTiming();
+        synth->processBlock(out);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * notesPerChord));
+}
+BENCHMARK(BM_PingSynthTriggerStorm)->ArgName("notes")->Arg(1)->Arg(10);
+
+// the same chords through triggerChord, all overtones of a chord are generated in one batch
+static void BM_PingSynthTriggerChord(benchmark::State& state)
+{
+    using Synth = PingSynth<BlockSize>;
+    const auto notesPerChord = static_cast<size_t>(state.range(0));
+    auto synth = std::make_unique<Synth>(SampleRate);
+    synth->setOddsOvertones(1.f);
+    synth->setEvenOvertones(1.f);
+    synth->setStretchedOvertones(1.f);
+    synth->setSpread(0.75f);
+    synth->setRandomPower(0.5f);
+    synth->setRandomSpread(0.5f);
+    synth->setMinOvertones(100);
+    synth->setMaxOvertones(100);
+
+    std::array<float, BlockSize> out{};
+    std::array<Synth::NoteOn, 16> chord{};
+    size_t note = 24;
+    for (auto _ : state)
+    {
+        for (size_t n = 0; n < notesPerChord; ++n)
+        {
+            chord[n] = {note, 1.f, 0};
+            note = note >= 96 ? 24 : note + 5;
+        }
+        synth->triggerChord({chord.data(), notesPerChord});
+        state.PauseTiming();
+        synth->processBlock(out);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * notesPerChord));
+}
+BENCHMARK(BM_PingSynthTriggerChord)->ArgName("notes")->Arg(1)->Arg(10);
@@ -0,0 +1,101 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <memory>
+
+#include "BenchConfig.h"
+#include "impl/ResoGenerator.h"
+
+using namespace BenchConfig;
+using Generator = ResoGenerator<BlockSize, NumElements>;
+
+namespace
+{
+// numActive resonators spread over the slots of the lowest 1 / clustering of the range
+std::unique_ptr<Generator> makeRinging(const size_t numActive, const bool multirate = false,
+                                       const size_t clustering = 1)
+{
+    auto generator = std::make_unique<Generator>(SampleRate, MinMidiNote, StepsPerSemitone);
+    generator->setMultirate(multirate);
+    generator->setDecay(1.f); // long tails, so nothing decays out while measuring
+    std::array<float, BlockSize> out{};
+    for (size_t k = 0; k < numActive; ++k)
+    {
+        generator->triggerNew(k * NumElements / (numActive * clustering), 0.1f, 0);
+        if (k % 1024 == 1023)
+        {
+            generator->processBlock(out);
+        }
+    }
+    generator->processBlock(out);
+    return generator;
+}
+} // namespace
+
+// ns per sample per active resonator shows up as "resonator_samples" (inverted rate, i.e. seconds each)
+static void BM_ResoGeneratorProcessBlock(benchmark::State& state)
+{
+    const auto numActive = static_cast<size_t>(state.range(0));
+    auto generator = makeRinging(numActive);
+    std::array<float, BlockSize> out{};
+    for (auto _ : state)
+    {
+        generator->processBlock(out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * BlockSize));
+    state.counters["resonator_samples"] =
+        benchmark::Counter(static_cast<double>(std::max<size_t>(numActive, 1) * BlockSize),
+                           benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_ResoGeneratorProcessBlock)->Arg(0)->Arg(100)->Arg(1000)->Arg(NumElements);
+
+static void BM_ResoGeneratorMultirate(benchmark::State& state)
+{
+    auto generator = makeRinging(static_cast<size_t>(state.range(0)), state.range(1) != 0);
+    std::array<float, BlockSize> out{};
+    for (auto _ : state)
+    {
+        generator->processBlock(out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * BlockSize));
+}
+BENCHMARK(BM_ResoGeneratorMultirate)->ArgNames({"active", "multirate"})->ArgsProduct({{1000, NumElements}, {0, 1}});
+
+static void BM_ResoGeneratorDecaySweep(benchmark::State& state)
+{
+    auto generator = makeRinging(static_cast<size_t>(state.range(0)));
+    generator->setLazyDecayUpdate(state.range(1) != 0);
+    std::array<float, BlockSize> out{};
+    float decay = 0.f;
+    for (auto _ : state)
+    {
+        decay = decay > 1.f ? 0.f : decay + 0.01f;
+        generator->setDecay(decay);
+        generator->processBlock(out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * BlockSize));
+}
+BENCHMARK(BM_ResoGeneratorDecaySweep)->ArgNames({"active", "lazy"})->ArgsProduct({{0, 100, 1000}, {0, 1}});
+
+// render threads against one, on all slots and on resonators packed into the lowest quarter of the range; the
+// "threads" counter shows how many setRenderThreads() actually started on this machine
+static void BM_ResoGeneratorThreads(benchmark::State& state)
+{
+    auto generator = makeRinging(static_cast<size_t>(state.range(0)), false, static_cast<size_t>(state.range(2)));
+    generator->setRenderThreads(static_cast<size_t>(state.range(1)));
+    std::array<float, BlockSize> out{};
+    for (auto _ : state)
+    {
+        generator->processBlock(out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * BlockSize));
+    state.counters["threads"] = static_cast<double>(generator->renderThreads());
+}
+BENCHMARK(BM_ResoGeneratorThreads)
+    ->ArgNames({"active", "threads", "clustering"})
+    ->ArgsProduct({{1000, NumElements / 4}, {1, 2, 4}, {1, 4}})
+    ->UseRealTime();
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+ * Minimal standard MIDI file (format 0 and 1) reader. All tracks are merged into one list of channel
+ * messages, stamped in seconds through the tempo map. Sysex and meta events other than tempo are skipped.
+ */
+class MidiFileReader
+{
+  public:
+    struct Event
+    {
+        double seconds;
+        std::array<uint8_t, 3> data;
+        size_t size;
+    };
+
+    explicit MidiFileReader(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            throw std::runtime_error("cannot open " + path);
+        }
+        m_bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        parse();
+    }
+
+    [[nodiscard]] const std::vector<Event>& events() const noexcept
+    {
+        return m_events;
+    }
+
+    [[nodiscard]] double lengthSeconds() const noexcept
+    {
+        return m_events.empty() ? 0.0 : m_events.back().seconds;
+    }
+
+  private:
+    struct TickEvent
+    {
+        uint64_t tick;
+        size_t order;
+        uint32_t tempo; // 0 for channel messages
+        std::array<uint8_t, 3> data;
+        size_t size;
+    };
+
+    void parse()
+    {
+        size_t pos = 0;
+        expectChunk(pos, "MThd");
+        const auto headerLength = readBE(pos, 4);
+        const auto numTracks = readBE(pos + 6, 2);
+        const auto division = static_cast<uint16_t>(readBE(pos + 8, 2));
+        pos += 4 + headerLength;
+
+        std::vector<TickEvent> tickEvents;
+        for (size_t t = 0; t < numTracks; ++t)
+        {
+            expectChunk(pos, "MTrk");
+            const auto trackLength = readBE(pos, 4);
+            pos += 4;
+            parseTrack(pos, pos + trackLength, tickEvents);
+            pos += trackLength;
+        }
+        std::stable_sort(tickEvents.begin(), tickEvents.end(),
+                         [](const TickEvent& a, const TickEvent& b)
+                         { return a.tick < b.tick || (a.tick == b.tick && a.order < b.order); });
+        toSeconds(tickEvents, division);
+    }
+
+    void parseTrack(size_t pos, const size_t end, std::vector<TickEvent>& out)
+    {
+        uint64_t tick = 0;
+        uint8_t runningStatus = 0;
+        while (pos < end)
+        {
+            tick += readVarLen(pos);
+            auto status = byteAt(pos);
+            if (status < 0x80)
+            {
+                status = runningStatus;
+            }
+            else
+            {
+                ++pos;
+            }
+
+            if (status == 0xFF)
+            {
+                const auto type = byteAt(pos++);
+                const auto length = readVarLen(pos);
+                if (type == 0x51 && length == 3)
+                {
+                    out.push_back({tick, out.size(), static_cast<uint32_t>(readBE(pos, 3)), {}, 0});
+                }
+                pos += length;
+                continue;
+            }
+            if (status == 0xF0 || status == 0xF7)
+            {
+                pos += readVarLen(pos);
+                continue;
+            }
+            if (status < 0x80)
+            {
+                throw std::runtime_error("midi file: data byte without running status");
+            }
+
+            runningStatus = status;
+            const auto type = status & 0xF0;
+            const size_t size = (type == 0xC0 || type == 0xD0) ? 2 : 3;
+            TickEvent event{tick, out.size(), 0, {status, 0, 0}, size};
+            for (size_t i = 1; i < size; ++i)
+            {
+                event.data[i] = byteAt(pos++);
+            }
+            out.push_back(event);
+        }
+    }
+
+    void toSeconds(const std::vector<TickEvent>& tickEvents, const uint16_t division)
+    {
+        double secondsPerTick;
+        if (division & 0x8000)
+        {
+            const auto framesPerSecond = -static_cast<int8_t>(division >> 8);
+            secondsPerTick = 1.0 / (framesPerSecond * (division & 0xFF));
+        }
+        else
+        {
+            secondsPerTick = 0.5 / division; // 120 bpm until the first tempo event
+        }
+
+        double seconds = 0.0;
+        uint64_t lastTick = 0;
+        for (const auto& e : tickEvents)
+        {
+            seconds += static_cast<double>(e.tick - lastTick) * secondsPerTick;
+            lastTick = e.tick;
+            if (e.size == 0)
+            {
+                if (!(division & 0x8000))
+                {
+                    secondsPerTick = e.tempo * 1E-6 / division;
+                }
+                continue;
+            }
+            m_events.push_back({seconds, e.data, e.size});
+        }
+    }
+
+    void expectChunk(size_t& pos, const char* id) const
+    {
+        if (pos + 8 > m_bytes.size() || !std::equal(id, id + 4, m_bytes.begin() + static_cast<std::ptrdiff_t>(pos)))
+        {
+            throw std::runtime_error(std::string("midi file: expected chunk ") + id);
+        }
+        pos += 4;
+    }
+
+    [[nodiscard]] uint8_t byteAt(const size_t pos) const
+    {
+        if (pos >= m_bytes.size())
+        {
+            throw std::runtime_error("midi file: unexpected end of data");
+        }
+        return m_bytes[pos];
+    }
+
+    [[nodiscard]] uint32_t readBE(const size_t pos, const size_t count) const
+    {
+        uint32_t value = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            value = (value << 8) | byteAt(pos + i);
+        }
+        return value;
+    }
+
+    uint32_t readVarLen(size_t& pos) const
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            const auto b = byteAt(pos++);
+            value = (value << 7) | (b & 0x7F);
+            if (!(b & 0x80))
+            {
+                break;
+            }
+        }
+        return value;
+    }
+
+    std::vector<uint8_t> m_bytes;
+    std::vector<Event> m_events;
+};
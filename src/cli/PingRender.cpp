@@ -0,0 +1,321 @@
+/*
+ * Offline renderer: plays a standard MIDI file through PingSynthExplorerPedal and streams a stereo WAV, or
+ * AIFF for .aif / .aiff output names, to disk while rendering, so the memory use does not grow with the length.
+ *
+ * usage: PingRender <in.mid> <out.wav> [preset.txt] [--rate <Hz>] [--tail <seconds>] [--threads <n>]
+ *                   [--pin-threads] [--floor <dBFS>] [--max-resonators <n>] [--multirate] [--seed <n>]
+ *                   [--burst-cache <MB>] [--excitation-sample <file>]
+ *
+ * The preset is a text file of "<parameter id> <value>" lines using the plugin's parameter ids (vol, reverbLevel,
+ * user1 ... user15) and units, '#' starts a comment. panMode (0 center, 1 frequency, 2 spread side, 3 random) and
+ * panWidth (0 ... 1) place the resonators in the stereo field, noteOffDamping 1 damps a note's resonators on its
+ * note-off (default 0, they ring out), collisionPolicy (0 replace, 1 sum, 2 max, 3 queue) handles retriggers of a slot
+ * that is still excited, excitationShape (0 sine, 1 impulse, 2 click, 3 mallet, 4 sample, 5 filtered noise) selects
+ * the burst that strikes the resonators; --excitation-sample loads a WAV or AIFF for the sample shape and selects it.
+ * --burst-cache pre-renders the noise free excitation bursts per band of slots into an arena of that many megabytes.
+ * --pin-threads pins render worker k to core k, only worth it when nothing else runs on those cores.
+ */
+
+#include "MidiFileReader.h"
+#include "ParameterDefaults.h"
+#include "impl/AudioFile.h"
+#include "impl/ExcitationSampleFile.h"
+#include "impl/PingSynthExplorerPedal.h"
+#include "impl/StreamingAudioWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+constexpr size_t BlockSize{16};
+constexpr size_t HostBlockSize{512};
+using Pedal = PingSynthExplorerPedal<BlockSize>;
+
+const std::map<std::string, std::function<void(Pedal&, float)>>& parameterMap()
+{
+    static const std::map<std::string, std::function<void(Pedal&, float)>> map{
+        {"vol", [](Pedal& p, const float v) { p.setVol(v); }},
+        {"reverbLevel", [](Pedal& p, const float v) { p.setReverbLevel(v); }},
+        {"user1", [](Pedal& p, const float v) { p.setUser1(v); }},
+        {"user2", [](Pedal& p, const float v) { p.setUser2(v); }},
+        {"user3", [](Pedal& p, const float v) { p.setUser3(v); }},
+        {"user4", [](Pedal& p, const float v) { p.setUser4(v); }},
+        {"user5", [](Pedal& p, const float v) { p.setUser5(v); }},
+        {"user6", [](Pedal& p, const float v) { p.setUser6(v); }},
+        {"user7", [](Pedal& p, const float v) { p.setUser7(v); }},
+        {"user8", [](Pedal& p, const float v) { p.setUser8(v); }},
+        {"user9", [](Pedal& p, const float v) { p.setUser9(v); }},
+        {"user10", [](Pedal& p, const float v) { p.setUser10(v); }},
+        {"user11", [](Pedal& p, const float v) { p.setUser11(v); }},
+        {"user12", [](Pedal& p, const float v) { p.setUser12(v); }},
+        {"user13", [](Pedal& p, const float v) { p.setUser13(v); }},
+        {"user14", [](Pedal& p, const float v) { p.setUser14(v); }},
+        {"user15", [](Pedal& p, const float v) { p.setUser15(v); }},
+        {"panMode", [](Pedal& p, const float v) { p.setPanMode(static_cast<PanMode>(std::clamp(v, 0.f, 3.f))); }},
+        {"panWidth", [](Pedal& p, const float v) { p.setPanWidth(v); }},
+        {"noteOffDamping", [](Pedal& p, const float v) { p.setNoteOffDamping(v != 0.f); }},
+        {"collisionPolicy",
+         [](Pedal& p, const float v) { p.setCollisionPolicy(static_cast<CollisionPolicy>(std::clamp(v, 0.f, 3.f))); }},
+        {"excitationShape",
+         [](Pedal& p, const float v) { p.setExcitationShape(static_cast<ExcitationShape>(std::clamp(v, 0.f, 5.f))); }},
+    };
+    return map;
+}
+
+// pushes every parameter default like the plugin's prepareToPlay does, from the table of its parameter layout
+void applyDefaults(Pedal& pedal)
+{
+    for (const auto& [id, value] : ParameterDefaults::Defaults)
+    {
+        parameterMap().at(std::string(id))(pedal, value);
+    }
+}
+
+bool applyPreset(Pedal& pedal, const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::fprintf(stderr, "cannot open preset %s\n", path.c_str());
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line))
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string id;
+        float value;
+        if (!(fields >> id))
+        {
+            continue;
+        }
+        const auto it = parameterMap().find(id);
+        if (it == parameterMap().end() || !(fields >> value))
+        {
+            std::fprintf(stderr, "preset: ignoring '%s'\n", line.c_str());
+            continue;
+        }
+        it->second(pedal, value);
+    }
+    return true;
+}
+
+int usage()
+{
+    std::fprintf(stderr, "usage: PingRender <in.mid> <out.wav> [preset.txt] [--rate <Hz>] [--tail <seconds>] "
+                         "[--threads <n>] [--pin-threads] [--floor <dBFS>] [--max-resonators <n>] [--multirate] "
+                         "[--seed <n>] [--burst-cache <MB>] [--excitation-sample <file>]\n");
+    return 1;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string midiPath;
+    std::string wavPath;
+    std::string presetPath;
+    float sampleRate{48000.f};
+    double tailSeconds{3.0};
+    size_t numThreads{1};
+    bool pinThreads{false};
+    float floorDb{-100.f};
+    size_t maxResonators{0};
+    bool multirate{false};
+    uint64_t seed{RandomPool::DefaultSeed};
+    double burstCacheMb{0.0};
+    std::string samplePath;
+
+    int i = 1;
+    try
+    {
+        for (; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--rate" && i + 1 < argc)
+            {
+                sampleRate = std::stof(argv[++i]);
+            }
+            else if (arg == "--tail" && i + 1 < argc)
+            {
+                tailSeconds = std::stod(argv[++i]);
+            }
+            else if (arg == "--threads" && i + 1 < argc)
+            {
+                numThreads = std::stoul(argv[++i]);
+            }
+            else if (arg == "--pin-threads")
+            {
+                pinThreads = true;
+            }
+            else if (arg == "--floor" && i + 1 < argc)
+            {
+                floorDb = std::stof(argv[++i]);
+            }
+            else if (arg == "--max-resonators" && i + 1 < argc)
+            {
+                maxResonators = std::stoul(argv[++i]);
+            }
+            else if (arg == "--multirate")
+            {
+                multirate = true;
+            }
+            else if (arg == "--seed" && i + 1 < argc)
+            {
+                seed = std::stoull(argv[++i]);
+            }
+            else if (arg == "--burst-cache" && i + 1 < argc)
+            {
+                burstCacheMb = std::stod(argv[++i]);
+            }
+            else if (arg == "--excitation-sample" && i + 1 < argc)
+            {
+                samplePath = argv[++i];
+            }
+            else if (midiPath.empty())
+            {
+                midiPath = arg;
+            }
+            else if (wavPath.empty())
+            {
+                wavPath = arg;
+            }
+            else if (presetPath.empty())
+            {
+                presetPath = arg;
+            }
+            else
+            {
+                return usage();
+            }
+        }
+    }
+    catch (const std::logic_error&) // std::invalid_argument and std::out_of_range of the number conversions
+    {
+        std::fprintf(stderr, "invalid value '%s' for %s\n", argv[i], argv[i - 1]);
+        return usage();
+    }
+    if (midiPath.empty() || wavPath.empty())
+    {
+        return usage();
+    }
+
+    std::unique_ptr<MidiFileReader> midi;
+    try
+    {
+        midi = std::make_unique<MidiFileReader>(midiPath);
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    auto pedal = std::make_unique<Pedal>(sampleRate, HostBlockSize);
+    applyDefaults(*pedal);
+    pedal->setRandomSeed(seed);
+    pedal->setMultirate(multirate);
+    pedal->setExcitationCache(static_cast<size_t>(burstCacheMb * 1024 * 1024));
+    pedal->setRenderThreads(numThreads, pinThreads);
+    if (numThreads > 1 && pedal->renderThreads() < numThreads)
+    {
+        std::fprintf(stderr, "threads: rendering on %zu of the %zu requested\n", pedal->renderThreads(), numThreads);
+    }
+    pedal->setAudibilityFloor(floorDb);
+    if (maxResonators > 0)
+    {
+        pedal->setMaxActiveResonators(maxResonators);
+    }
+    if (!presetPath.empty() && !applyPreset(*pedal, presetPath))
+    {
+        return 1;
+    }
+    if (!samplePath.empty())
+    {
+        std::vector<float> samples;
+        if (!readExcitationSample(samplePath, samples) || !pedal->loadExcitationSample(samples))
+        {
+            std::fprintf(stderr, "cannot load excitation sample %s\n", samplePath.c_str());
+            return 1;
+        }
+        pedal->setExcitationShape(ExcitationShape::Sample);
+    }
+    // the preset may have changed the shape or the noise since setExcitationCache()
+    pedal->prepareExcitationCache();
+
+    const auto numSamples = static_cast<size_t>((midi->lengthSeconds() + tailSeconds) * sampleRate);
+    const auto numBlocks = (numSamples + BlockSize - 1) / BlockSize;
+    const auto isAiff = wavPath.ends_with(".aif") || wavPath.ends_with(".aiff");
+    StreamingAudioWriter writer;
+    if (!writer.open(wavPath, isAiff ? AudioFileFormat::Aiff : AudioFileFormat::Wave,
+                     static_cast<uint32_t>(sampleRate), Pedal::NumChannels, 32))
+    {
+        std::fprintf(stderr, "cannot write %s\n", wavPath.c_str());
+        return 1;
+    }
+    float interleaved[BlockSize * Pedal::NumChannels];
+
+    const auto& events = midi->events();
+    size_t nextEvent = 0;
+    AbacDsp::AudioBuffer<Pedal::NumChannels, BlockSize> in{};
+    AbacDsp::AudioBuffer<Pedal::NumChannels, BlockSize> out{};
+
+    const auto beginTime = std::chrono::steady_clock::now();
+    for (size_t b = 0; b < numBlocks; ++b)
+    {
+        const auto blockStart = b * BlockSize;
+        // hand over MIDI one host sized buffer at a time, like the plugin does
+        if (blockStart % HostBlockSize == 0)
+        {
+            const auto hostEnd = static_cast<double>(blockStart + HostBlockSize) / sampleRate;
+            for (; nextEvent < events.size() && events[nextEvent].seconds < hostEnd; ++nextEvent)
+            {
+                const auto& e = events[nextEvent];
+                pedal->scheduleMidi(e.data.data(), e.size, static_cast<uint64_t>(e.seconds * sampleRate));
+            }
+        }
+        pedal->processBlock(in, out);
+        const auto numFrames = std::min(BlockSize, numSamples - blockStart);
+        for (size_t i = 0; i < numFrames; ++i)
+        {
+            for (size_t c = 0; c < Pedal::NumChannels; ++c)
+            {
+                interleaved[i * Pedal::NumChannels + c] = out(i, c);
+            }
+        }
+        // offline there is no deadline, wait for the disk instead of dropping
+        while (writer.freeFrames() < numFrames)
+        {
+            std::this_thread::yield();
+        }
+        writer.write(interleaved, numFrames);
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - beginTime).count();
+
+    if (!writer.close())
+    {
+        std::fprintf(stderr, "cannot write %s\n", wavPath.c_str());
+        return 1;
+    }
+
+    if (pedal->rejectedMidiEvents() + pedal->earlyMidiEvents() > 0)
+    {
+        std::fprintf(stderr, "midi: %zu messages longer than 3 bytes ignored, %zu dispatched early\n",
+                     pedal->rejectedMidiEvents(), pedal->earlyMidiEvents());
+    }
+    const auto renderedSeconds = static_cast<double>(numSamples) / sampleRate;
+    std::printf("rendered %.2f s in %.3f s, real-time factor %.1fx\n", renderedSeconds, elapsed,
+                elapsed > 0 ? renderedSeconds / elapsed : 0.0);
+    return 0;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PingExcitation.h"
+
+/*
+ * Optional cache of pre-rendered excitation bursts in one contiguous arena. Every trigger starts the burst at
+ * the end of the pattern, so without noise a slot's excitation is a fixed sequence that only depends on its
+ * phase advance and the shape. Slots are grouped into bands of BandSlots neighbours sharing one burst; the owner
+ * moves the advances of the slots serves() accepts to the one of the band (see bandSlot()). prepareAll() builds
+ * the bursts of all bands up front, outside the audio callback; once the arena is full further bands render from
+ * the pattern as before, and so does every band after a change to another shape or to noise, until the next
+ * prepareAll().
+ * render() is const and can run on several threads, prepare(), prepareAll() and clear() must not run
+ * concurrently with it.
+ */
+template <size_t NumElements>
+class ExcitationBursts
+{
+  public:
+    static constexpr size_t BandSlots{11};
+    static constexpr size_t NumBands{(NumElements + BandSlots - 1) / BandSlots};
+
+    explicit ExcitationBursts(const Excitation& excitation)
+        : m_excitation(excitation)
+    {
+        clear();
+    }
+
+    // arena size in bytes, 0 disables the cache; allocates, call it outside the audio callback
+    void setCapacity(const size_t maxBytes)
+    {
+        m_arena.assign(maxBytes / sizeof(float), 0.f);
+        m_arena.shrink_to_fit();
+        clear();
+    }
+
+    [[nodiscard]] bool enabled() const noexcept
+    {
+        return !m_arena.empty();
+    }
+
+    // drops all bursts
+    void clear() noexcept
+    {
+        m_used = 0;
+        m_bursts.fill({NotBuilt, 0, 0.f});
+    }
+
+    // the slot whose frequency stands for the band of slot
+    [[nodiscard]] static size_t bandSlot(const size_t slot) noexcept
+    {
+        return std::min(slot / BandSlots * BandSlots + BandSlots / 2, NumElements - 1);
+    }
+
+    // rebuilds the bursts of all bands for the current shape, advances[j] is the phase advance of slot j
+    void prepareAll(const std::array<float, NumElements>& advances)
+    {
+        clear();
+        m_shape = m_excitation.getShape();
+        if (!enabled() || !m_excitation.deterministic())
+        {
+            return;
+        }
+        for (size_t slot = 0; slot < NumElements; slot += BandSlots)
+        {
+            prepare(slot, advances[bandSlot(slot)]);
+        }
+    }
+
+    // true while the bursts were built for the current shape and the excitation is free of noise
+    [[nodiscard]] bool matchesExcitation() const noexcept
+    {
+        return m_excitation.getShape() == m_shape && m_excitation.deterministic();
+    }
+
+    // true when render() plays a burst from the arena for slot at advance
+    [[nodiscard]] bool serves(const size_t slot, const float advance) const noexcept
+    {
+        const auto& burst = m_bursts[slot / BandSlots];
+        return burst.offset != NotBuilt && burst.advance == advance && matchesExcitation();
+    }
+
+    /*
+     * Excitation::render() for the resonator of slot: a multiply-add from the arena when its band has a burst
+     * for this advance and shape and the excitation is free of noise, otherwise rendered from the pattern.
+     */
+    size_t render(const size_t slot, float* out, const size_t stride, const size_t numSamples, float& position,
+                  const float advance, const float gain, uint32_t& noiseCursor) const noexcept
+    {
+        if (!serves(slot, advance))
+        {
+            return m_excitation.render(out, stride, numSamples, position, advance, gain, noiseCursor);
+        }
+        const auto& burst = m_bursts[slot / BandSlots];
+        if (position <= 0.f)
+        {
+            return 0;
+        }
+        const auto step = m_excitation.patternStep(advance);
+        const auto done = std::min(static_cast<size_t>(std::lround((startPosition() - position) / step)),
+                                   static_cast<size_t>(burst.length));
+        const auto count = std::min(numSamples, burst.length - done);
+        const auto* src = m_arena.data() + burst.offset + done;
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i * stride] += gain * src[i];
+        }
+        position = done + count == burst.length ? 0.f : startPosition() - static_cast<float>(done + count) * step;
+        noiseCursor += static_cast<uint32_t>(count);
+        return count;
+    }
+
+    [[nodiscard]] size_t usedBytes() const noexcept
+    {
+        return m_used * sizeof(float);
+    }
+
+  private:
+    static constexpr uint32_t NotBuilt{~uint32_t{0}};
+
+    struct Burst
+    {
+        uint32_t offset;
+        uint32_t length;
+        float advance;
+    };
+
+    // builds the burst of the band of slot for advance, false when it does not fit
+    bool prepare(const size_t slot, const float advance)
+    {
+        auto& burst = m_bursts[slot / BandSlots];
+        auto position = startPosition();
+        const auto length = m_excitation.renderLength(position, advance);
+        if (length > m_arena.size() - m_used)
+        {
+            return false;
+        }
+        auto* dst = m_arena.data() + m_used;
+        std::fill_n(dst, length, 0.f);
+        uint32_t noiseCursor = 0;
+        m_excitation.render(dst, 1, length, position, advance, 1.f, noiseCursor);
+        burst = {static_cast<uint32_t>(m_used), static_cast<uint32_t>(length), advance};
+        m_used += length;
+        return true;
+    }
+
+    [[nodiscard]] float startPosition() const noexcept
+    {
+        return static_cast<float>(m_excitation.getPatternLength() - 1);
+    }
+
+    const Excitation& m_excitation;
+    std::vector<float> m_arena;
+    size_t m_used{0};
+    std::array<Burst, NumBands> m_bursts{};
+    ExcitationShape m_shape{ExcitationShape::Sine}; // the shape the bursts were built for
+};
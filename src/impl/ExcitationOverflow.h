@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "ExcitationBursts.h"
+
+/*
+ * Fixed pool of additional excitation cursors for slots that get triggered again while their excitation is
+ * still running. The resonator is linear, so feeding it the sum of both excitations is the same as running
+ * a second resonator on the same frequency, without the second resonator. No allocation after construction;
+ * add() fails when all cursors are in use.
+ */
+template <size_t NumElements, size_t Capacity>
+class ExcitationOverflow
+{
+    static_assert(Capacity < 256, "per slot cursor counts are 8 bit");
+
+  public:
+    bool add(const size_t slot, const float position, const float advance, const float gain, const size_t waitBlocks,
+             const size_t startOffset, const uint32_t noiseCursor) noexcept
+    {
+        if (m_numCursors == Capacity)
+        {
+            return false;
+        }
+        m_cursors[m_numCursors++] = {static_cast<uint32_t>(slot),
+                                     position,
+                                     advance,
+                                     gain,
+                                     static_cast<uint32_t>(waitBlocks),
+                                     static_cast<uint32_t>(startOffset),
+                                     noiseCursor};
+        ++m_cursorsOfSlot[slot];
+        return true;
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return m_numCursors == 0;
+    }
+
+    [[nodiscard]] bool pending(const size_t slot) const noexcept
+    {
+        return m_cursorsOfSlot[slot] != 0;
+    }
+
+    // counts down the waiting cursors, call once per block before rendering
+    void beginBlock() noexcept
+    {
+        for (size_t c = 0; c < m_numCursors; ++c)
+        {
+            if (m_cursors[c].wait > 0)
+            {
+                --m_cursors[c].wait;
+            }
+        }
+    }
+
+    // adds the running cursors of slot to dst[i * stride], i < numSamples; cursors of different slots may be
+    // rendered from different threads
+    void render(const size_t slot, float* dst, const size_t numSamples, const size_t stride,
+                const ExcitationBursts<NumElements>& bursts) noexcept
+    {
+        for (size_t c = 0; c < m_numCursors; ++c)
+        {
+            auto& cursor = m_cursors[c];
+            if (cursor.slot != slot || cursor.wait > 0)
+            {
+                continue;
+            }
+            const size_t start = cursor.startOffset;
+            cursor.startOffset = 0;
+            if (start < numSamples)
+            {
+                bursts.render(slot, dst + start * stride, stride, numSamples - start, cursor.position,
+                              cursor.advance, cursor.gain, cursor.noiseCursor);
+            }
+        }
+    }
+
+    // frees the finished cursors, call once per block after rendering
+    void endBlock() noexcept
+    {
+        size_t c = 0;
+        while (c < m_numCursors)
+        {
+            if (m_cursors[c].position > 0.f)
+            {
+                ++c;
+                continue;
+            }
+            --m_cursorsOfSlot[m_cursors[c].slot];
+            m_cursors[c] = m_cursors[--m_numCursors];
+        }
+    }
+
+    void dropSlot(const size_t slot) noexcept
+    {
+        for (size_t c = 0; c < m_numCursors && m_cursorsOfSlot[slot] != 0; ++c)
+        {
+            if (m_cursors[c].slot == slot)
+            {
+                m_cursors[c].position = 0.f;
+            }
+        }
+    }
+
+  private:
+    struct Cursor
+    {
+        uint32_t slot;
+        float position;
+        float advance;
+        float gain;
+        uint32_t wait;
+        uint32_t startOffset;
+        uint32_t noiseCursor;
+    };
+
+    std::array<Cursor, Capacity> m_cursors{};
+    size_t m_numCursors{0};
+    std::array<uint8_t, NumElements> m_cursorsOfSlot{};
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "MappedAudioFile.h"
+
+/*
+ * Reads the first channel of a WAV or AIFF file for the Sample excitation shape, see Excitation::setSample().
+ * Kept out of the engine headers, which take the samples as a span and do no file I/O. Returns false and
+ * leaves samples as they were when the file cannot be read or holds fewer than two frames. Not real-time safe.
+ */
+inline bool readExcitationSample(const std::string& path, std::vector<float>& samples)
+{
+    const MappedAudioFile file(path);
+    if (!file.isOpen() || file.getNumSamplesPerChannel() < 2)
+    {
+        return false;
+    }
+    const auto channel = file.channel(0);
+    samples.resize(channel.size());
+    channel.copyTo(samples.data(), 0, samples.size());
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Maps a frequency to the nearest slot of a log spaced resonator grid, round(log2(f / f0) * slotsPerOctave),
+ * without calling log2. The exponent of the float gives the octave, the top mantissa bits index a table of
+ * log2(1 + m) already scaled to slots, and the remaining bits interpolate linearly between its entries.
+ * With 256 segments the interpolation error is below 2.2e-6 octaves, under 0.002 slots at 792 slots per
+ * octave, so the result only differs from the exact mapping for frequencies that close to a rounding boundary.
+ */
+class FrequencyIndexMapper
+{
+  public:
+    FrequencyIndexMapper(const float baseFrequency, const float slotsPerOctave, const size_t numSlots)
+        : m_slotsPerOctave(slotsPerOctave)
+        , m_offset(std::log2(baseFrequency) * slotsPerOctave - 0.5f)
+        , m_maxIndex(numSlots - 1)
+    {
+        for (size_t i = 0; i <= Segments; ++i)
+        {
+            m_table[i] = std::log2(1.f + static_cast<float>(i) / Segments) * slotsPerOctave;
+        }
+    }
+
+    // frequencies at or below the base map to slot 0, beyond the grid to the last slot; so do negative and NaN
+    // ones, whose sign bit would otherwise land in the exponent
+    [[nodiscard]] size_t operator()(const float frequency) const noexcept
+    {
+        if (!(frequency > 0.f))
+        {
+            return 0;
+        }
+        const auto exact = slotsAboveBase(frequency);
+        if (!(exact > 0.f))
+        {
+            return 0;
+        }
+        return std::min(static_cast<size_t>(exact), m_maxIndex);
+    }
+
+  private:
+    static constexpr uint32_t SegmentBits{8};
+    static constexpr size_t Segments{size_t{1} << SegmentBits};
+    static constexpr uint32_t FractionBits{23 - SegmentBits};
+
+    // log2(frequency / f0) * slotsPerOctave + 0.5 for positive normal floats, the octave part is an exact
+    // integer product so the large terms cancel before the table value is added
+    [[nodiscard]] float slotsAboveBase(const float frequency) const noexcept
+    {
+        const auto bits = std::bit_cast<uint32_t>(frequency);
+        const auto exponent = static_cast<int>(bits >> 23) - 127;
+        const auto segment = (bits >> FractionBits) & (Segments - 1);
+        const auto fraction =
+            static_cast<float>(bits & ((1u << FractionBits) - 1)) * (1.f / static_cast<float>(1u << FractionBits));
+        const auto mantissa = m_table[segment] + fraction * (m_table[segment + 1] - m_table[segment]);
+        return (static_cast<float>(exponent) * m_slotsPerOctave - m_offset) + mantissa;
+    }
+
+    float m_slotsPerOctave;
+    float m_offset;
+    size_t m_maxIndex;
+    std::array<float, Segments + 1> m_table{};
+};
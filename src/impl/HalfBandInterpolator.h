@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+/*
+ * 2x polyphase interpolator on a 19 tap Kaiser windowed (beta 8) half-band FIR. Flat up to 0.2 of the input
+ * rate, the image band from 0.8 of the input rate on is down by more than 80 dB. The odd output phase is a
+ * plain delay, the even phase takes 10 multiplies. Group delay is 9 output samples.
+ */
+template <size_t MaxInput>
+class HalfBandInterpolator
+{
+  public:
+    static constexpr size_t Taps{10};
+
+    // reads numInput <= MaxInput samples, writes 2 * numInput
+    void process(const float* in, float* out, const size_t numInput) noexcept
+    {
+        std::copy_n(in, numInput, m_buffer.begin() + History);
+        for (size_t n = 0; n < numInput; ++n)
+        {
+            const float* x = m_buffer.data() + History + n;
+            float even = 0.f;
+            for (size_t k = 0; k < Taps; ++k)
+            {
+                even += Coefficients[k] * x[-static_cast<std::ptrdiff_t>(k)];
+            }
+            out[2 * n] = even;
+            out[2 * n + 1] = x[-4];
+        }
+        std::copy_n(m_buffer.begin() + numInput, History, m_buffer.begin());
+    }
+
+    void reset() noexcept
+    {
+        m_buffer.fill(0.f);
+    }
+
+  private:
+    static constexpr size_t History{Taps - 1};
+    static constexpr std::array<float, Taps> Coefficients{
+        1.654487277e-04f, -5.942961455e-03f, 3.640295491e-02f, -1.384689048e-01f, 6.078434626e-01f,
+        6.078434626e-01f, -1.384689048e-01f, 3.640295491e-02f, -5.942961455e-03f, 1.654487277e-04f,
+    };
+
+    std::array<float, History + MaxInput> m_buffer{};
+};
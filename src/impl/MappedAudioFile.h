@@ -0,0 +1,444 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <type_traits>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "AudioFile.h"
+
+/*
+ * Read only WAV / AIFF access without loading the file: it is memory mapped, the headers are parsed in place
+ * and samples are converted on access, with the same conversions AudioFile<float> uses. Reads 8 to 32 bit
+ * integer PCM, 32 and 64 bit float WAV (also as WAVE_FORMAT_EXTENSIBLE), AIFF and AIFC with NONE, sowt,
+ * fl32 or fl64. interleaved<T>() exposes the mapped samples directly when they are stored as native T.
+ * Opening and closing are not real-time safe, reading is.
+ */
+class MappedAudioFile
+{
+  public:
+    // one channel of the mapped data, converts each sample to float when it is read
+    class ChannelView
+    {
+      public:
+        [[nodiscard]] size_t size() const noexcept
+        {
+            return m_size;
+        }
+
+        [[nodiscard]] float operator[](const size_t i) const noexcept
+        {
+            return m_file->decode(m_first + i * m_file->m_bytesPerFrame);
+        }
+
+        // converts numSamples samples starting at offset into dst, returns the number converted
+        size_t copyTo(float* dst, const size_t offset, const size_t numSamples) const noexcept
+        {
+            const auto count = offset < m_size ? std::min(numSamples, m_size - offset) : 0;
+            const auto* src = m_first + offset * m_file->m_bytesPerFrame;
+            for (size_t i = 0; i < count; ++i)
+            {
+                dst[i] = m_file->decode(src + i * m_file->m_bytesPerFrame);
+            }
+            return count;
+        }
+
+      private:
+        friend class MappedAudioFile;
+
+        ChannelView(const MappedAudioFile* file, const uint8_t* first, const size_t size) noexcept
+            : m_file(file)
+            , m_first(first)
+            , m_size(size)
+        {
+        }
+
+        const MappedAudioFile* m_file;
+        const uint8_t* m_first;
+        size_t m_size;
+    };
+
+    MappedAudioFile() = default;
+    MappedAudioFile(const MappedAudioFile&) = delete;
+    MappedAudioFile& operator=(const MappedAudioFile&) = delete;
+
+    explicit MappedAudioFile(const std::string& path)
+    {
+        open(path);
+    }
+
+    ~MappedAudioFile()
+    {
+        close();
+    }
+
+    // false when the file cannot be mapped or is not a supported WAV or AIFF
+    bool open(const std::string& path)
+    {
+        close();
+        if (!map(path))
+        {
+            return false;
+        }
+        const auto parsed = fileSize() >= 12 && (std::memcmp(m_data, "RIFF", 4) == 0 ? parseWave() : parseAiff());
+        if (!parsed || m_numChannels == 0 || m_bytesPerSample == 0 || m_sampleRate == 0)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() noexcept
+    {
+        unmap();
+        m_format = AudioFileFormat::NotLoaded;
+        m_samples = nullptr;
+        m_numFrames = 0;
+        m_numChannels = 0;
+        m_bytesPerSample = 0;
+    }
+
+    [[nodiscard]] bool isOpen() const noexcept
+    {
+        return m_samples != nullptr;
+    }
+
+    [[nodiscard]] AudioFileFormat getFormat() const noexcept
+    {
+        return m_format;
+    }
+
+    [[nodiscard]] uint32_t getSampleRate() const noexcept
+    {
+        return m_sampleRate;
+    }
+
+    [[nodiscard]] size_t getNumChannels() const noexcept
+    {
+        return m_numChannels;
+    }
+
+    [[nodiscard]] size_t getNumSamplesPerChannel() const noexcept
+    {
+        return m_numFrames;
+    }
+
+    [[nodiscard]] int getBitDepth() const noexcept
+    {
+        return static_cast<int>(m_bytesPerSample * 8);
+    }
+
+    [[nodiscard]] bool isFloatingPoint() const noexcept
+    {
+        return m_float;
+    }
+
+    [[nodiscard]] ChannelView channel(const size_t c) const noexcept
+    {
+        return {this, m_samples + c * m_bytesPerSample, c < m_numChannels ? m_numFrames : 0};
+    }
+
+    [[nodiscard]] float sample(const size_t c, const size_t i) const noexcept
+    {
+        return decode(m_samples + i * m_bytesPerFrame + c * m_bytesPerSample);
+    }
+
+    /*
+     * The interleaved samples as stored, numChannels * numSamplesPerChannel of them, when they are native T:
+     * float for 32 bit float, int16_t or int32_t for PCM of that width, in host byte order and aligned.
+     * Empty otherwise, then channel() converts.
+     */
+    template <typename T>
+    [[nodiscard]] std::span<const T> interleaved() const noexcept
+    {
+        const auto matches = sizeof(T) == m_bytesPerSample && std::is_floating_point_v<T> == m_float &&
+                             m_littleEndian == (std::endian::native == std::endian::little) &&
+                             reinterpret_cast<uintptr_t>(m_samples) % alignof(T) == 0;
+        if (!isOpen() || !matches)
+        {
+            return {};
+        }
+        return {reinterpret_cast<const T*>(m_samples), m_numFrames * m_numChannels};
+    }
+
+  private:
+    [[nodiscard]] size_t fileSize() const noexcept
+    {
+        return m_size;
+    }
+
+    [[nodiscard]] uint32_t read(const size_t offset, const size_t numBytes, const bool littleEndian) const noexcept
+    {
+        uint32_t value = 0;
+        for (size_t b = 0; b < numBytes; ++b)
+        {
+            value |= static_cast<uint32_t>(m_data[offset + b]) << (8 * (littleEndian ? b : numBytes - 1 - b));
+        }
+        return value;
+    }
+
+    [[nodiscard]] float decode(const uint8_t* p) const noexcept
+    {
+        uint64_t raw = 0;
+        for (size_t b = 0; b < m_bytesPerSample; ++b)
+        {
+            raw |= static_cast<uint64_t>(p[b]) << (8 * (m_littleEndian ? b : m_bytesPerSample - 1 - b));
+        }
+        if (m_float)
+        {
+            return m_bytesPerSample == 8 ? static_cast<float>(std::bit_cast<double>(raw))
+                                         : std::bit_cast<float>(static_cast<uint32_t>(raw));
+        }
+        switch (m_bytesPerSample)
+        {
+            case 1:
+                return m_format == AudioFileFormat::Wave
+                           ? AudioSampleConverter<float>::unsignedByteToSample(static_cast<uint8_t>(raw))
+                           : AudioSampleConverter<float>::signedByteToSample(static_cast<int8_t>(raw));
+            case 2:
+                return AudioSampleConverter<float>::sixteenBitIntToSample(static_cast<int16_t>(raw));
+            case 3:
+                return AudioSampleConverter<float>::twentyFourBitIntToSample(
+                    static_cast<int32_t>(static_cast<uint32_t>(raw) << 8) >> 8);
+            default:
+                return AudioSampleConverter<float>::thirtyTwoBitIntToSample(static_cast<int32_t>(raw));
+        }
+    }
+
+    // fills in the layout from the sample format, false for anything unsupported
+    bool setLayout(const size_t numChannels, const size_t bitDepth, const bool isFloat, const bool littleEndian)
+    {
+        if (bitDepth % 8 != 0 || bitDepth == 0 || bitDepth > 64 || (isFloat && bitDepth != 32 && bitDepth != 64) ||
+            (!isFloat && bitDepth > 32))
+        {
+            return false;
+        }
+        m_numChannels = numChannels;
+        m_bytesPerSample = bitDepth / 8;
+        m_bytesPerFrame = numChannels * m_bytesPerSample;
+        m_float = isFloat;
+        m_littleEndian = littleEndian;
+        return m_numChannels > 0;
+    }
+
+    bool parseWave()
+    {
+        if (std::memcmp(m_data + 8, "WAVE", 4) != 0)
+        {
+            return false;
+        }
+        bool haveFormat = false;
+        for (size_t chunk = 12; chunk + 8 <= fileSize();)
+        {
+            const auto chunkSize = read(chunk + 4, 4, true);
+            const auto body = chunk + 8;
+            if (std::memcmp(m_data + chunk, "fmt ", 4) == 0 && body + 16 <= fileSize())
+            {
+                auto tag = read(body, 2, true);
+                if (tag == 0xFFFE && chunkSize >= 26 && body + 26 <= fileSize())
+                {
+                    tag = read(body + 24, 2, true); // sub format GUID
+                }
+                if (tag != 1 && tag != 3)
+                {
+                    return false;
+                }
+                m_sampleRate = read(body + 4, 4, true);
+                haveFormat = setLayout(read(body + 2, 2, true), read(body + 14, 2, true), tag == 3, true);
+                if (!haveFormat)
+                {
+                    return false;
+                }
+            }
+            else if (std::memcmp(m_data + chunk, "data", 4) == 0 && haveFormat)
+            {
+                // a file that is still being written may claim more than there is
+                const auto available = std::min<size_t>(chunkSize, fileSize() - body);
+                m_samples = m_data + body;
+                m_numFrames = available / m_bytesPerFrame;
+                m_format = AudioFileFormat::Wave;
+                return true;
+            }
+            chunk = body + chunkSize + (chunkSize & 1);
+        }
+        return false;
+    }
+
+    bool parseAiff()
+    {
+        const auto isAifc = std::memcmp(m_data + 8, "AIFC", 4) == 0;
+        if (std::memcmp(m_data, "FORM", 4) != 0 || (!isAifc && std::memcmp(m_data + 8, "AIFF", 4) != 0))
+        {
+            return false;
+        }
+        bool haveFormat = false;
+        size_t numFrames = 0;
+        for (size_t chunk = 12; chunk + 8 <= fileSize();)
+        {
+            const auto chunkSize = read(chunk + 4, 4, false);
+            const auto body = chunk + 8;
+            if (std::memcmp(m_data + chunk, "COMM", 4) == 0 && body + 18 <= fileSize())
+            {
+                auto isFloat = false;
+                auto littleEndian = false;
+                if (isAifc && body + 22 <= fileSize())
+                {
+                    const auto* compression = m_data + body + 18;
+                    isFloat = std::memcmp(compression, "fl32", 4) == 0 || std::memcmp(compression, "FL32", 4) == 0 ||
+                              std::memcmp(compression, "fl64", 4) == 0 || std::memcmp(compression, "FL64", 4) == 0;
+                    littleEndian = std::memcmp(compression, "sowt", 4) == 0;
+                    if (!isFloat && !littleEndian && std::memcmp(compression, "NONE", 4) != 0)
+                    {
+                        return false;
+                    }
+                }
+                numFrames = read(body + 2, 4, false);
+                // an 80 bit float, a corrupt one may be negative, NaN or far beyond what fits the cast
+                const auto sampleRate = AiffUtilities::decodeAiffSampleRate(m_data + body + 8);
+                if (!(sampleRate >= 1.0 && sampleRate <= 4294967295.0))
+                {
+                    return false;
+                }
+                m_sampleRate = static_cast<uint32_t>(sampleRate);
+                haveFormat = setLayout(read(body, 2, false), read(body + 6, 2, false), isFloat, littleEndian);
+                if (!haveFormat)
+                {
+                    return false;
+                }
+            }
+            else if (std::memcmp(m_data + chunk, "SSND", 4) == 0 && haveFormat && body + 8 <= fileSize())
+            {
+                const auto start = body + 8 + read(body, 4, false);
+                if (start > fileSize())
+                {
+                    return false;
+                }
+                m_samples = m_data + start;
+                m_numFrames = std::min(numFrames, (fileSize() - start) / m_bytesPerFrame);
+                m_format = AudioFileFormat::Aiff;
+                return true;
+            }
+            chunk = body + chunkSize + (chunkSize & 1);
+        }
+        return false;
+    }
+
+#if defined(_WIN32)
+    bool map(const std::string& path)
+    {
+        m_fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_fileHandle == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(m_fileHandle, &fileSize) || fileSize.QuadPart == 0)
+        {
+            unmap();
+            return false;
+        }
+        m_mapping = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping)
+        {
+            unmap();
+            return false;
+        }
+        m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        m_size = m_data ? static_cast<size_t>(fileSize.QuadPart) : 0;
+        if (!m_data)
+        {
+            unmap();
+            return false;
+        }
+        return true;
+    }
+
+    void unmap() noexcept
+    {
+        if (m_data)
+        {
+            UnmapViewOfFile(m_data);
+        }
+        if (m_mapping)
+        {
+            CloseHandle(m_mapping);
+        }
+        if (m_fileHandle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_fileHandle);
+        }
+        m_data = nullptr;
+        m_size = 0;
+        m_mapping = nullptr;
+        m_fileHandle = INVALID_HANDLE_VALUE;
+    }
+
+    HANDLE m_fileHandle{INVALID_HANDLE_VALUE};
+    HANDLE m_mapping{nullptr};
+#else
+    bool map(const std::string& path)
+    {
+        const auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat status{};
+        if (::fstat(fd, &status) != 0 || status.st_size <= 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        auto* data = ::mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping keeps the file referenced
+        ::close(fd);
+        if (data == MAP_FAILED)
+        {
+            return false;
+        }
+        m_data = static_cast<const uint8_t*>(data);
+        m_size = static_cast<size_t>(status.st_size);
+        return true;
+    }
+
+    void unmap() noexcept
+    {
+        if (m_data)
+        {
+            ::munmap(const_cast<uint8_t*>(m_data), m_size);
+        }
+        m_data = nullptr;
+        m_size = 0;
+    }
+#endif
+
+    const uint8_t* m_data{nullptr};
+    size_t m_size{0};
+    AudioFileFormat m_format{AudioFileFormat::NotLoaded};
+    const uint8_t* m_samples{nullptr};
+    size_t m_numFrames{0};
+    size_t m_numChannels{0};
+    size_t m_bytesPerSample{0};
+    size_t m_bytesPerFrame{0};
+    uint32_t m_sampleRate{0};
+    bool m_float{false};
+    bool m_littleEndian{true};
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Fixed capacity multi producer / single consumer ring, after Vyukov's bounded queue. A producer claims a cell
+ * by advancing the head with a compare-exchange, the sequence number of the cell tells the consumer when the
+ * write into it is complete. Like SpscQueue a full queue drops the event and counts it, no producer waits.
+ */
+template <typename T, size_t Capacity>
+class MpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+  public:
+    MpscQueue() noexcept
+    {
+        for (size_t i = 0; i < Capacity; ++i)
+        {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    bool push(const T& event) noexcept
+    {
+        auto head = m_head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            auto& cell = m_cells[head & Mask];
+            const auto lag = static_cast<std::ptrdiff_t>(cell.sequence.load(std::memory_order_acquire) - head);
+            if (lag == 0)
+            {
+                if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed))
+                {
+                    cell.event = event;
+                    cell.sequence.store(head + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (lag < 0)
+            {
+                // the cell still holds an event of the previous lap
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                head = m_head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // hands the complete events to consumer in push order; stops at a cell a producer is still writing
+    template <typename Consumer>
+    size_t drain(Consumer&& consumer) noexcept
+    {
+        size_t count = 0;
+        while (true)
+        {
+            auto& cell = m_cells[m_tail & Mask];
+            if (cell.sequence.load(std::memory_order_acquire) != m_tail + 1)
+            {
+                return count;
+            }
+            consumer(cell.event);
+            cell.sequence.store(m_tail + Capacity, std::memory_order_release);
+            ++m_tail;
+            ++count;
+        }
+    }
+
+    [[nodiscard]] size_t droppedCount() const noexcept
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    static constexpr size_t capacity() noexcept
+    {
+        return Capacity;
+    }
+
+  private:
+    static constexpr size_t Mask{Capacity - 1};
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T event;
+    };
+
+    std::array<Cell, Capacity> m_cells{};
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) size_t m_tail{0};
+    std::atomic<size_t> m_dropped{0};
+};
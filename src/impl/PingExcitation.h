@@ -4,8 +4,12 @@
 #include <span>
 #include <numbers>
 #include <cmath>
-#include <random>
+#include <complex>
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "RandomPool.h"
 
 class WindowFunctions
 {
@@ -39,38 +43,145 @@ class WindowFunctions
     }
 };
 
+enum class ExcitationShape : uint8_t
+{
+    Sine,          // Hann windowed two period sine, optionally mixed with noise
+    Impulse,       // a single sample
+    Click,         // raised cosine, an eighth of the sine burst long
+    Mallet,        // skewed half sine, a quarter of the sine burst long
+    Sample,        // a user sample squeezed into the pattern, pitched like the sine
+    FilteredNoise, // low passed noise under a Hann envelope, ignores the noise mix
+};
+
+/*
+ * Excitation bursts in several shapes. Each shape is a kernel the render loop is instantiated for, so the
+ * shape is dispatched once per call and not per sample. All shapes are driven by the pattern position and
+ * phase advance of the sine: the advance makes the sine last two periods of the resonator, the shorter
+ * shapes step through the pattern faster. Their gains are chosen so the component at the resonator
+ * frequency matches the sine's, a different shape changes the colour rather than the level.
+ * The tables are read only while rendering, so one instance can serve every resonator and thread: the read
+ * position and the noise cursor belong to the resonator. The noise table is a power of two long and small
+ * enough to stay in cache, its cursor wraps by masking and is not interpolated.
+ */
 class Excitation
 {
   public:
-    static constexpr size_t NumNoise{65535};
-    explicit Excitation(size_t patternLength = 1024)
+    static constexpr size_t NoiseSize{size_t{1} << 13};
+
+    explicit Excitation(size_t patternLength = 1024, const uint64_t noiseSeed = RandomPool::DefaultSeed)
         : m_sineLength(patternLength)
         , m_sine(patternLength + 1, 0.0f)
-        , m_noise(NumNoise, 0.0f)
+        , m_window(patternLength + 1, 0.0f)
+        , m_mallet(patternLength + 1, 0.0f)
+        , m_noise(NoiseSize, 0.0f)
+        , m_filteredNoise(NoiseSize, 0.0f)
         , m_noiseFactor(0.0f)
     {
         generateSineWave();
-        generateNoise();
+        generateMallet();
+        m_sample = m_sine;
+        m_resonance = resonance(m_sine, 1);
+        m_clickGain = shapeGain(m_window, ClickSpeed);
+        m_malletGain = shapeGain(m_mallet, MalletSpeed);
+        generateNoise(noiseSeed);
     }
 
-    float getInterpolatedValue(const float position) noexcept
+    // where the noise of a resonator starts, spread over the table so neighbouring slots decorrelate
+    [[nodiscard]] static uint32_t noiseStart(const size_t slot) noexcept
     {
-        if (position < 0.0f || m_sine.empty())
+        return static_cast<uint32_t>(slot) * 0x9E3779B1u;
+    }
+
+    /*
+     * adds gain * excitation to out[i * stride] for i < numSamples, starting at pattern position `position`
+     * and stepping down by patternStep(advance) until the pattern is used up. Advances position and
+     * noiseCursor and returns the number of samples written. Requires position <= patternLength - 1.
+     */
+    size_t render(float* out, const size_t stride, const size_t numSamples, float& position, const float advance,
+                  const float gain, uint32_t& noiseCursor) const noexcept
+    {
+        const auto step = patternStep(advance);
+        const auto patternGain = gain * (1.0f - m_noiseFactor);
+        const auto noiseGain = gain * m_noiseFactor;
+        switch (m_shape)
         {
-            return 0.0f;
+            case ExcitationShape::Sine:
+                return renderKernel(PatternKernel{m_sine.data(), m_noise.data(), patternGain, noiseGain}, out,
+                                    stride, numSamples, position, step, noiseCursor);
+            case ExcitationShape::Impulse:
+                return renderKernel(ImpulseKernel{gain * m_resonance / advance}, out, stride, numSamples, position,
+                                    step, noiseCursor);
+            case ExcitationShape::Click:
+                return renderKernel(
+                    PatternKernel{m_window.data(), m_noise.data(), patternGain * m_clickGain, noiseGain}, out,
+                    stride, numSamples, position, step, noiseCursor);
+            case ExcitationShape::Mallet:
+                return renderKernel(
+                    PatternKernel{m_mallet.data(), m_noise.data(), patternGain * m_malletGain, noiseGain}, out,
+                    stride, numSamples, position, step, noiseCursor);
+            case ExcitationShape::Sample:
+                return renderKernel(
+                    PatternKernel{m_sample.data(), m_noise.data(), patternGain * m_sampleGain, noiseGain}, out,
+                    stride, numSamples, position, step, noiseCursor);
+            case ExcitationShape::FilteredNoise:
+                // white noise of unit variance has the same expected energy at the resonator as the sine
+                return renderKernel(
+                    NoiseKernel{m_window.data(), m_filteredNoise.data(),
+                                gain * m_resonance / std::sqrt(0.375f * static_cast<float>(m_sineLength) * advance)},
+                    out, stride, numSamples, position, step, noiseCursor);
+        }
+        return 0;
+    }
+
+    // pattern positions per sample for the current shape; the impulse uses up the pattern in one sample
+    [[nodiscard]] float patternStep(const float advance) const noexcept
+    {
+        switch (m_shape)
+        {
+            case ExcitationShape::Impulse:
+                return static_cast<float>(m_sineLength - 1);
+            case ExcitationShape::Click:
+                return advance * ClickSpeed;
+            case ExcitationShape::Mallet:
+                return advance * MalletSpeed;
+            default:
+                return advance;
         }
+    }
+
+    // samples render() writes from position until the pattern is used up
+    [[nodiscard]] size_t renderLength(const float position, const float advance) const noexcept
+    {
+        return position > 0.f ? stepsLeft(position, patternStep(advance)) : 0;
+    }
 
-        const size_t index0 = static_cast<size_t>(position);
-        const size_t index1 = index0 + 1;
-        const float fraction = position - static_cast<float>(index0);
+    // true when every burst of the same advance is the same, no noise involved
+    [[nodiscard]] bool deterministic() const noexcept
+    {
+        return m_shape == ExcitationShape::Impulse ||
+               (m_shape != ExcitationShape::FilteredNoise && m_noiseFactor == 0.f);
+    }
 
-        const float sineValue = m_sine[index0] * (1.0f - fraction) + m_sine[index1] * fraction;
-        const float noiseValue = m_noise[m_noiseIndex] * (1.0f - fraction) + m_noise[m_noiseIndex + 1] * fraction;
+    /*
+     * One sample of the excitation at pattern position, for code that steps through the pattern itself. Blends
+     * the interpolated sine with the noise like render() and advances a noise cursor of its own, so unlike
+     * render() it must not be shared between resonators or threads. Positions past the pattern end are clamped.
+     */
+    float getInterpolatedValue(const float position) noexcept
+    {
+        if (position < 0.0f || m_sine.size() < 2)
+        {
+            return 0.0f;
+        }
+        const auto clamped = std::min(position, static_cast<float>(m_sine.size() - 2));
+        const auto index0 = static_cast<size_t>(clamped);
+        const auto fraction = clamped - static_cast<float>(index0);
 
-        const float sineWeight = 1.0f - m_noiseFactor;
-        const float noiseWeight = m_noiseFactor;
-        m_noiseIndex = (m_noiseIndex + 1) % (NumNoise - 1);
-        return sineWeight * sineValue + noiseWeight * noiseValue;
+        const auto sineValue = m_sine[index0] + fraction * (m_sine[index0 + 1] - m_sine[index0]);
+        const auto noiseValue = m_noise[m_noiseIndex] +
+                                fraction * (m_noise[(m_noiseIndex + 1) & (NoiseSize - 1)] - m_noise[m_noiseIndex]);
+        m_noiseIndex = (m_noiseIndex + 1) & (NoiseSize - 1);
+        return (1.0f - m_noiseFactor) * sineValue + m_noiseFactor * noiseValue;
     }
 
     const std::vector<float>& getPattern() const noexcept
@@ -103,12 +214,150 @@ class Excitation
         return m_noiseFactor;
     }
 
-    void regenerateNoise()
+    void setShape(const ExcitationShape shape) noexcept
+    {
+        m_shape = shape;
+    }
+
+    [[nodiscard]] ExcitationShape getShape() const noexcept
+    {
+        return m_shape;
+    }
+
+    void regenerateNoise(const uint64_t seed)
+    {
+        generateNoise(seed);
+    }
+
+    /*
+     * Uses source as the Sample shape: it is resampled onto the pattern, so it plays as long as the two sine
+     * periods and follows the resonator pitch. Returns false and keeps the previous sample for fewer than two
+     * samples. Not real-time safe; see ExcitationSampleFile.h for reading one from a file.
+     */
+    bool setSample(const std::span<const float> source)
     {
-        generateNoise();
+        if (source.size() < 2)
+        {
+            return false;
+        }
+        // the pattern is read from its end, so the start of the source goes there
+        const auto scale = static_cast<float>(source.size() - 1) / static_cast<float>(m_sineLength - 1);
+        float peak = 0.f;
+        for (size_t i = 0; i < m_sineLength; ++i)
+        {
+            const auto t = static_cast<float>(m_sineLength - 1 - i) * scale;
+            const auto index = std::min(static_cast<size_t>(t), source.size() - 2);
+            const auto fraction = t - static_cast<float>(index);
+            m_sample[i] = source[index] + fraction * (source[index + 1] - source[index]);
+            peak = std::max(peak, std::abs(m_sample[i]));
+        }
+        m_sample[m_sineLength] = 0.f;
+        if (peak > 0.f)
+        {
+            for (auto& value : m_sample)
+            {
+                value /= peak;
+            }
+        }
+        m_sampleGain = shapeGain(m_sample, 1);
+        return true;
     }
 
   private:
+    static constexpr float ClickSpeed{8.f};
+    static constexpr float MalletSpeed{4.f};
+
+    // linearly interpolated table, blended with the white noise
+    struct PatternKernel
+    {
+        const float* table;
+        const float* noise;
+        float tableGain;
+        float noiseGain;
+
+        float operator()(const float p, const size_t n) const noexcept
+        {
+            const auto index = static_cast<int>(p);
+            const auto fraction = p - static_cast<float>(index);
+            return tableGain * (table[index] + fraction * (table[index + 1] - table[index])) + noiseGain * noise[n];
+        }
+    };
+
+    // filtered noise under the interpolated envelope
+    struct NoiseKernel
+    {
+        const float* envelope;
+        const float* noise;
+        float gain;
+
+        float operator()(const float p, const size_t n) const noexcept
+        {
+            const auto index = static_cast<int>(p);
+            const auto fraction = p - static_cast<float>(index);
+            return gain * (envelope[index] + fraction * (envelope[index + 1] - envelope[index])) * noise[n];
+        }
+    };
+
+    struct ImpulseKernel
+    {
+        float height;
+
+        float operator()(float, size_t) const noexcept
+        {
+            return height;
+        }
+    };
+
+    [[nodiscard]] static size_t stepsLeft(const float position, const float step) noexcept
+    {
+        auto count = static_cast<size_t>(position / step);
+        if (position - static_cast<float>(count) * step > 0.f)
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    template <typename Kernel>
+    static size_t renderKernel(const Kernel kernel, float* out, const size_t stride, const size_t numSamples,
+                               float& position, const float step, uint32_t& noiseCursor) noexcept
+    {
+        if (position <= 0.f)
+        {
+            return 0;
+        }
+        const auto count = std::min(stepsLeft(position, step), numSamples);
+        const auto start = position;
+        const auto cursor = noiseCursor;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto p = start - static_cast<float>(static_cast<int>(i)) * step;
+            out[i * stride] += kernel(p, (cursor + static_cast<uint32_t>(i)) & (NoiseSize - 1));
+        }
+        position = start - static_cast<float>(count) * step;
+        noiseCursor = cursor + static_cast<uint32_t>(count);
+        return count;
+    }
+
+    // magnitude of the resonator frequency component of a table read speed times faster than the sine,
+    // in pattern positions; the sine pattern holds two periods
+    [[nodiscard]] float resonance(const std::vector<float>& table, const float speed) const
+    {
+        const auto omega = 4.0 * std::numbers::pi / (static_cast<double>(m_sineLength) * speed);
+        std::complex<double> sum{};
+        for (size_t i = 0; i < m_sineLength; ++i)
+        {
+            sum += static_cast<double>(table[i]) * std::polar(1.0, -omega * static_cast<double>(i));
+        }
+        return static_cast<float>(std::abs(sum));
+    }
+
+    // gain that gives a shape the resonance of the sine, at most 18 dB above its own level
+    [[nodiscard]] float shapeGain(const std::vector<float>& table, const float speed) const
+    {
+        return speed * m_resonance / std::max(resonance(table, speed), m_resonance / 8.f);
+    }
+
     void generateSineWave()
     {
         const float periodsInPattern = 2.0f;
@@ -124,25 +373,71 @@ class Excitation
         for (size_t i = 0; i < m_sineLength; ++i)
         {
             m_sine[i] *= window[i];
+            m_window[i] = window[i];
         }
 
         m_sine[m_sineLength] = 0.0f;
+        m_window[m_sineLength] = 0.0f;
     }
 
-    void generateNoise()
+    // half sine peaking at 37% of its length, a fast attack and a softer release
+    void generateMallet()
     {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution distribution(.0f, 4.0f);
+        for (size_t i = 0; i < m_sineLength; ++i)
+        {
+            const auto t = static_cast<float>(m_sineLength - 1 - i) / static_cast<float>(m_sineLength - 1);
+            m_mallet[i] = std::sin(std::numbers::pi_v<float> * std::pow(t, 0.7f));
+        }
+        m_mallet[m_sineLength] = 0.0f;
+    }
+
+    void generateNoise(const uint64_t seed)
+    {
+        RandomPool random(seed);
         for (size_t i = 0; i < m_noise.size(); ++i)
         {
-            m_noise[i] = distribution(gen);
+            m_noise[i] = 4.0f * random.uniform();
+        }
+        generateFilteredNoise();
+    }
+
+    // one pole low pass of the centred noise, run twice so the wrap around is seamless, unit variance
+    void generateFilteredNoise()
+    {
+        constexpr float coefficient{0.2f};
+        float state = 0.f;
+        for (size_t pass = 0; pass < 2; ++pass)
+        {
+            for (size_t i = 0; i < NoiseSize; ++i)
+            {
+                state += coefficient * (m_noise[i] - 2.f - state);
+                m_filteredNoise[i] = state;
+            }
+        }
+        float sumSquares = 0.f;
+        for (const auto value : m_filteredNoise)
+        {
+            sumSquares += value * value;
+        }
+        const auto scale = 1.f / std::sqrt(sumSquares / static_cast<float>(NoiseSize));
+        for (auto& value : m_filteredNoise)
+        {
+            value *= scale;
         }
     }
 
     size_t m_sineLength;
     std::vector<float> m_sine;
+    std::vector<float> m_window;
+    std::vector<float> m_mallet;
+    std::vector<float> m_sample;
     std::vector<float> m_noise;
+    std::vector<float> m_filteredNoise;
     size_t m_noiseIndex{0};
     float m_noiseFactor;
-};
\ No newline at end of file
+    ExcitationShape m_shape{ExcitationShape::Sine};
+    float m_resonance{1.f};
+    float m_clickGain{1.f};
+    float m_malletGain{1.f};
+    float m_sampleGain{1.f};
+};
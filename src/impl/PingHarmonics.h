@@ -1,26 +1,53 @@
 #pragma once
 
-#include <functional>
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include "FrequencyIndexMapper.h"
+
+// overtones per generator and note, higher counts are cut off here
+inline constexpr size_t MaxOvertones{512};
+
+/*
+ * Overtones of one or more notes as structure of arrays. The generators append one pass per field, so
+ * frequency, power and order are computed in loops the compiler vectorizes, and the sink walks the result.
+ * Entries with power <= 0.001 are kept and skipped by the consumer. A batch holds the overtones of MaxNotes
+ * notes from all NumGenerators generators, larger chords take several batches.
+ */
+struct OvertoneBatch
+{
+    static constexpr size_t MaxNotes{4};
+    static constexpr size_t NumGenerators{3}; // odd, even and stretched
+    static constexpr size_t Capacity{MaxNotes * NumGenerators * MaxOvertones};
+
+    std::array<float, Capacity> frequency;
+    std::array<float, Capacity> power;
+    std::array<float, Capacity> order;
+    std::array<uint32_t, Capacity> index;
+    std::array<uint8_t, Capacity> spread;
+    size_t size{0};
+};
 
-template <size_t NumElements>
+/*
+ * The generators are composed at compile time: Sink is a small value type with
+ *   float humanRandomness()
+ * the harmonic generators only draw randomness from it, their overtones are returned in an OvertoneBatch.
+ */
+template <size_t NumElements, typename Sink>
 class HarmonicGeneratorBase
 {
   public:
-    using TriggerCallback = std::function<void(size_t, float, float)>;
-    using SpreadCallback = std::function<void(size_t, float)>;
-
     explicit HarmonicGeneratorBase(const std::array<float, NumElements>& frequencies,
-                                   const std::function<size_t(float)>& getFrequencyIndex,
-                                   const std::function<float()>& getHumanRandomness, float& currentVelocity,
-                                   float randomPower, TriggerCallback triggerCallback, SpreadCallback spreadCallback)
+                                   const FrequencyIndexMapper& getFrequencyIndex, Sink sink, float& currentVelocity,
+                                   float randomPower)
         : m_frequencies(frequencies)
         , m_getFrequencyIndex(getFrequencyIndex)
-        , m_getHumanRandomness(getHumanRandomness)
+        , m_sink(sink)
         , m_currentVelocity(currentVelocity)
         , m_randomPower(randomPower)
-        , m_triggerCallback(std::move(triggerCallback))
-        , m_spreadCallback(std::move(spreadCallback))
     {
     }
     void setMinMaxOvertone(const std::pair<int, int>& overtoneCount)
@@ -28,40 +55,81 @@ class HarmonicGeneratorBase
         m_overtoneCount = overtoneCount;
     }
 
-    virtual ~HarmonicGeneratorBase() = default;
-    virtual void generateHarmonics(size_t index, float power) = 0;
-
   protected:
     const std::array<float, NumElements>& m_frequencies;
-    const std::function<size_t(float)>& m_getFrequencyIndex;
-    const std::function<float()>& m_getHumanRandomness;
+    const FrequencyIndexMapper& m_getFrequencyIndex;
+    Sink m_sink;
     float& m_currentVelocity;
     float m_randomPower;
-    TriggerCallback m_triggerCallback;
-    SpreadCallback m_spreadCallback;
     std::pair<int, int> m_overtoneCount{3, 10};
 
-    void triggerHarmonic(const size_t targetIndex, const float overtonePower, const int order) noexcept
+    // number of overtones from firstOvertone on to fill in, bounded by the velocity scaled count and MaxOvertones
+    [[nodiscard]] size_t batchCount(const int firstOvertone) const noexcept
     {
-        if (overtonePower > 0.001f)
+        const auto count = getMaxOvertone() - firstOvertone + 1;
+        return count > 0 ? std::min(static_cast<size_t>(count), MaxOvertones) : 0;
+    }
+
+    /*
+     * completes the entries after batch.size whose frequency the generator filled in for overtone numbers
+     * firstOvertone, firstOvertone + 1, ...: cuts them at the top slot, then maps slots, powers and orders.
+     * The order of an overtone is its number minus orderShift.
+     */
+    void appendOvertones(OvertoneBatch& batch, size_t count, const int firstOvertone, const int orderShift,
+                         const float value, const float power) noexcept
+    {
+        const auto begin = batch.size;
+        const auto maxFreq = m_frequencies.back();
+        const auto* frequency = batch.frequency.data() + begin;
+        count = static_cast<size_t>(std::find_if(frequency, frequency + count,
+                                                 [maxFreq](const float f) { return f >= maxFreq; }) -
+                                    frequency);
+
+        auto* index = batch.index.data() + begin;
+        for (size_t k = 0; k < count; ++k)
+        {
+            index[k] = static_cast<uint32_t>(m_getFrequencyIndex(frequency[k]));
+        }
+
+        const int maxOvertone = getMaxOvertone();
+        auto* overtonePower = batch.power.data() + begin;
+        const auto positionRange = static_cast<float>(maxOvertone - firstOvertone);
+        // the shape branch is hoisted so both loops vectorize
+        if (value <= 0.5f)
         {
-            m_triggerCallback(targetIndex, overtonePower,
-                              static_cast<float>(order) / static_cast<float>(getMaxOvertone()));
-            if (order < m_overtoneCount.first)
+            for (size_t k = 0; k < count; ++k)
             {
-                m_spreadCallback(targetIndex, overtonePower);
+                overtonePower[k] =
+                    decayingOvertonePower(power, value, static_cast<float>(static_cast<int>(k)) / positionRange);
+            }
+        }
+        else
+        {
+            for (size_t k = 0; k < count; ++k)
+            {
+                overtonePower[k] =
+                    risingOvertonePower(power, value, static_cast<float>(static_cast<int>(k)) / positionRange);
             }
         }
-    }
-
-    [[nodiscard]] float applyPowerRandomness(const float power) const noexcept
-    {
         if (m_randomPower > 0.0f)
         {
-            const auto powerVariation = 1.0f + m_getHumanRandomness() * m_randomPower * 0.3f;
-            return power * powerVariation;
+            for (size_t k = 0; k < count; ++k)
+            {
+                overtonePower[k] *= 1.0f + m_sink.humanRandomness() * m_randomPower * 0.3f;
+            }
         }
-        return power;
+
+        auto* order = batch.order.data() + begin;
+        auto* spread = batch.spread.data() + begin;
+        const auto orderRange = static_cast<float>(maxOvertone);
+        const auto firstOrder = firstOvertone - orderShift;
+        for (size_t k = 0; k < count; ++k)
+        {
+            const auto overtoneOrder = firstOrder + static_cast<int>(k);
+            order[k] = static_cast<float>(overtoneOrder) / orderRange;
+            spread[k] = overtoneOrder < m_overtoneCount.first ? 1 : 0;
+        }
+        batch.size += count;
     }
 
     [[nodiscard]] int getMaxOvertone() const noexcept
@@ -70,42 +138,41 @@ class HarmonicGeneratorBase
                                 m_currentVelocity * (m_overtoneCount.second - m_overtoneCount.first));
     }
 
-    [[nodiscard]] static float calculateOvertonePower(const float basePower, const float value,
-                                                      const float overtonePosition) noexcept
+    // value <= 0.5: fades from full power on the first overtone towards value * 2
+    [[nodiscard]] static float decayingOvertonePower(const float basePower, const float value,
+                                                     const float overtonePosition) noexcept
     {
-        float p;
-        if (value <= 0.5f)
-        {
-            const auto decayFactor = 1.0f - overtonePosition;
-            const auto blend = value * 2.0f;
-            p= basePower * value * (decayFactor * (1.0f - blend) + blend);
-        }else
-        {
-            const auto increaseFactor = overtonePosition;
-            const auto blend = value * 2.f - 1.f;
-            p= basePower * 0.5f * (1.f - blend + increaseFactor * blend);
-        }
-        return p*p*p;
+        const auto decayFactor = 1.0f - overtonePosition;
+        const auto blend = value * 2.0f;
+        const auto p = basePower * value * (decayFactor * (1.0f - blend) + blend);
+        return p * p * p;
+    }
+
+    // value > 0.5: rises towards the last overtone
+    [[nodiscard]] static float risingOvertonePower(const float basePower, const float value,
+                                                   const float overtonePosition) noexcept
+    {
+        const auto increaseFactor = overtonePosition;
+        const auto blend = value * 2.f - 1.f;
+        const auto p = basePower * 0.5f * (1.f - blend + increaseFactor * blend);
+        return p * p * p;
     }
 };
 
-template <size_t NumElements>
-class OddHarmonicGenerator final : public HarmonicGeneratorBase<NumElements>
+template <size_t NumElements, typename Sink>
+class OddHarmonicGenerator final : public HarmonicGeneratorBase<NumElements, Sink>
 {
   private:
     float m_odds{0.0f};
     float m_skewOdds{1.0f};
 
   public:
-    using Base = HarmonicGeneratorBase<NumElements>;
+    using Base = HarmonicGeneratorBase<NumElements, Sink>;
 
     explicit OddHarmonicGenerator(const std::array<float, NumElements>& frequencies,
-                                  const std::function<size_t(float)>& getFrequencyIndex,
-                                  const std::function<float()>& getHumanRandomness, float& currentVelocity,
-                                  float randomPower, typename Base::TriggerCallback triggerCallback,
-                                  typename Base::SpreadCallback spreadCallback)
-        : Base(frequencies, getFrequencyIndex, getHumanRandomness, currentVelocity, randomPower,
-               std::move(triggerCallback), std::move(spreadCallback))
+                                  const FrequencyIndexMapper& getFrequencyIndex, Sink sink, float& currentVelocity,
+                                  float randomPower)
+        : Base(frequencies, getFrequencyIndex, sink, currentVelocity, randomPower)
     {
     }
 
@@ -119,7 +186,8 @@ class OddHarmonicGenerator final : public HarmonicGeneratorBase<NumElements>
         m_skewOdds = std::pow(2.0f, value);
     }
 
-    void generateHarmonics(const size_t index, const float power) override
+    // appends the odd overtones of the slot index to batch
+    void generateHarmonics(const size_t index, const float power, OvertoneBatch& batch) noexcept
     {
         if (m_odds <= 0.0f)
         {
@@ -127,44 +195,31 @@ class OddHarmonicGenerator final : public HarmonicGeneratorBase<NumElements>
         }
 
         const auto currentFreq = this->m_frequencies[index];
-        const auto maxFreq = this->m_frequencies.back();
-        const int maxOvertone = this->getMaxOvertone();
-
-        for (int overtoneNum = 1; overtoneNum <= maxOvertone; ++overtoneNum)
+        const auto count = this->batchCount(1);
+        auto* frequency = batch.frequency.data() + batch.size;
+        for (size_t k = 0; k < count; ++k)
         {
-            const auto overtoneMultiplier = (2 * overtoneNum + 1) * m_skewOdds;
-            const auto overtoneFreq = currentFreq * overtoneMultiplier;
-            if (overtoneFreq >= maxFreq)
-            {
-                break;
-            }
-            const auto targetIndex = this->m_getFrequencyIndex(overtoneFreq);
-            const auto overtonePosition = static_cast<float>(overtoneNum - 1) / (maxOvertone - 1);
-            const auto overtonePower =
-                this->applyPowerRandomness(this->calculateOvertonePower(power, m_odds, overtonePosition));
-
-            this->triggerHarmonic(targetIndex, overtonePower, overtoneNum);
+            const int overtoneNum = 1 + static_cast<int>(k);
+            frequency[k] = currentFreq * ((2 * overtoneNum + 1) * m_skewOdds);
         }
+        this->appendOvertones(batch, count, 1, 0, m_odds, power);
     }
 };
 
-template <size_t NumElements>
-class EvenHarmonicGenerator final : public HarmonicGeneratorBase<NumElements>
+template <size_t NumElements, typename Sink>
+class EvenHarmonicGenerator final : public HarmonicGeneratorBase<NumElements, Sink>
 {
   private:
     float m_evens{0.0f};
     float m_skewEvens{1.0f};
 
   public:
-    using Base = HarmonicGeneratorBase<NumElements>;
+    using Base = HarmonicGeneratorBase<NumElements, Sink>;
 
     explicit EvenHarmonicGenerator(const std::array<float, NumElements>& frequencies,
-                                   const std::function<size_t(float)>& getFrequencyIndex,
-                                   const std::function<float()>& getHumanRandomness, float& currentVelocity,
-                                   float randomPower, typename Base::TriggerCallback triggerCallback,
-                                   typename Base::SpreadCallback spreadCallback)
-        : Base(frequencies, getFrequencyIndex, getHumanRandomness, currentVelocity, randomPower,
-               std::move(triggerCallback), std::move(spreadCallback))
+                                   const FrequencyIndexMapper& getFrequencyIndex, Sink sink, float& currentVelocity,
+                                   float randomPower)
+        : Base(frequencies, getFrequencyIndex, sink, currentVelocity, randomPower)
     {
     }
 
@@ -178,49 +233,39 @@ class EvenHarmonicGenerator final : public HarmonicGeneratorBase<NumElements>
         m_skewEvens = std::pow(2.0f, value);
     }
 
-    void generateHarmonics(const size_t index, const float power) override
+    // appends the even overtones of the slot index to batch
+    void generateHarmonics(const size_t index, const float power, OvertoneBatch& batch) noexcept
     {
         if (m_evens <= 0.0f)
         {
             return;
         }
-        const auto currentFreq = this->m_frequencies[index];
-        const auto maxFreq = this->m_frequencies.back();
-        const int maxOvertone = this->getMaxOvertone();
 
-        for (int overtoneNum = 1; overtoneNum <= maxOvertone; ++overtoneNum)
+        const auto currentFreq = this->m_frequencies[index];
+        const auto count = this->batchCount(1);
+        auto* frequency = batch.frequency.data() + batch.size;
+        for (size_t k = 0; k < count; ++k)
         {
-            const auto overtoneMultiplier = static_cast<float>(2 * overtoneNum) * m_skewEvens;
-            const auto overtoneFreq = currentFreq * overtoneMultiplier;
-            if (overtoneFreq >= maxFreq)
-            {
-                break;
-            }
-            const auto targetIndex = this->m_getFrequencyIndex(overtoneFreq);
-            const auto overtonePosition = static_cast<float>(overtoneNum - 1) / (maxOvertone - 1);
-            auto overtonePower =
-                this->applyPowerRandomness(this->calculateOvertonePower(power, m_evens, overtonePosition));
-            this->triggerHarmonic(targetIndex, overtonePower, overtoneNum);
+            const int overtoneNum = 1 + static_cast<int>(k);
+            frequency[k] = currentFreq * (static_cast<float>(2 * overtoneNum) * m_skewEvens);
         }
+        this->appendOvertones(batch, count, 1, 0, m_evens, power);
     }
 };
 
-template <size_t NumElements>
-class StretchedHarmonicGenerator final : public HarmonicGeneratorBase<NumElements>
+template <size_t NumElements, typename Sink>
+class StretchedHarmonicGenerator final : public HarmonicGeneratorBase<NumElements, Sink>
 {
   private:
     float m_stretched{0.0f};
 
   public:
-    using Base = HarmonicGeneratorBase<NumElements>;
+    using Base = HarmonicGeneratorBase<NumElements, Sink>;
 
     explicit StretchedHarmonicGenerator(const std::array<float, NumElements>& frequencies,
-                                        const std::function<size_t(float)>& getFrequencyIndex,
-                                        const std::function<float()>& getHumanRandomness, float& currentVelocity,
-                                        float randomPower, typename Base::TriggerCallback triggerCallback,
-                                        typename Base::SpreadCallback spreadCallback)
-        : Base(frequencies, getFrequencyIndex, getHumanRandomness, currentVelocity, randomPower,
-               std::move(triggerCallback), std::move(spreadCallback))
+                                        const FrequencyIndexMapper& getFrequencyIndex, Sink sink,
+                                        float& currentVelocity, float randomPower)
+        : Base(frequencies, getFrequencyIndex, sink, currentVelocity, randomPower)
     {
     }
 
@@ -229,7 +274,8 @@ class StretchedHarmonicGenerator final : public HarmonicGeneratorBase<NumElement
         m_stretched = value;
     }
 
-    void generateHarmonics(const size_t index, const float power) override
+    // appends the stretched overtones of the slot index to batch, their orders start at 1
+    void generateHarmonics(const size_t index, const float power, OvertoneBatch& batch) noexcept
     {
         if (m_stretched <= 0.0f)
         {
@@ -237,24 +283,16 @@ class StretchedHarmonicGenerator final : public HarmonicGeneratorBase<NumElement
         }
 
         const auto currentFreq = this->m_frequencies[index];
-        const auto maxFreq = this->m_frequencies.back();
-        const int maxOvertone = this->getMaxOvertone();
-
-        for (int overtoneNum = 2; overtoneNum <= maxOvertone; ++overtoneNum)
+        const auto count = this->batchCount(2);
+        const auto B = m_stretched * 0.01f;
+        auto* frequency = batch.frequency.data() + batch.size;
+        for (size_t k = 0; k < count; ++k)
         {
             // Piano-like inharmonicity: f_n = f_0 * n * sqrt(1 + B * n^2)
-            const auto B = m_stretched * 0.01f;
+            const int overtoneNum = 2 + static_cast<int>(k);
             const auto stretchFactor = std::sqrt(1.0f + B * overtoneNum * overtoneNum);
-            const auto overtoneFreq = currentFreq * overtoneNum * stretchFactor;
-            if (overtoneFreq >= maxFreq)
-            {
-                break;
-            }
-            const auto targetIndex = this->m_getFrequencyIndex(overtoneFreq);
-            const auto overtonePosition = static_cast<float>(overtoneNum - 2) / (maxOvertone - 2);
-            auto overtonePower =
-                this->applyPowerRandomness(this->calculateOvertonePower(power, m_stretched, overtonePosition));
-            this->triggerHarmonic(targetIndex, overtonePower, overtoneNum - 1);
+            frequency[k] = currentFreq * overtoneNum * stretchFactor;
         }
+        this->appendOvertones(batch, count, 2, 1, m_stretched, power);
     }
 };
\ No newline at end of file
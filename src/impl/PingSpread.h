@@ -1,22 +1,28 @@
 #pragma once
 
 #include <array>
-#include <functional>
 #include <cmath>
 #include <algorithm>
+#include <cstddef>
 
-template <size_t N, int stepsPerSemitone>
+#include "FrequencyIndexMapper.h"
+#include "TraceLog.h"
+
+/*
+ * The spreads are triggered directly, Sink is a small value type with
+ *   void trigger(size_t index, float power, float order)
+ *   float humanRandomness()
+ *   float uniform()
+ */
+template <size_t N, int stepsPerSemitone, typename Sink>
 class PingSpread
 {
   public:
-    using TriggerCallback = std::function<void(size_t, float, size_t)>;
-
-    explicit PingSpread(const std::array<float, N>& frequencies, const std::function<size_t(float)>& getFrequencyIndex,
-                        const std::function<float()>& getHumanRandomness, TriggerCallback triggerCallback)
+    explicit PingSpread(const std::array<float, N>& frequencies, const FrequencyIndexMapper& getFrequencyIndex,
+                        Sink sink)
         : m_frequencies(frequencies)
         , m_getFrequencyIndex(getFrequencyIndex)
-        , m_getHumanRandomness(getHumanRandomness)
-        , m_triggerCallback(std::move(triggerCallback))
+        , m_sink(sink)
     {
     }
 
@@ -45,8 +51,7 @@ class PingSpread
 
     float getRandomSpread()
     {
-        std::uniform_real_distribution uniform(0.0f, 1.0f);
-        const float v = uniform(m_rng);
+        const float v = m_sink.uniform();
         return v * v * m_randomSpread * 3.f;
     }
 
@@ -60,40 +65,45 @@ class PingSpread
         if (m_spread < 0.5f)
         {
             const auto randomOffset = getRandomSpread()*beatDelta*0.5f;
-            std::cout << beatDelta << "\t" << randomOffset << std::endl;
+            PINGSYNTH_TRACE(TraceKind::Spread, beatDelta, randomOffset);
             const auto powerVariation =
-                m_randomPower > 0.0f ? 1.0f + m_getHumanRandomness() * m_randomPower * 0.5f : 1.0f;
+                m_randomPower > 0.0f ? 1.0f + m_sink.humanRandomness() * m_randomPower * 0.5f : 1.0f;
             const auto adjustedPower = m_spread * 2 * power * powerVariation;
-            const auto targetIndex = static_cast<size_t>(index + beatDelta + randomOffset);
-            m_triggerCallback(targetIndex, adjustedPower, 1);
+            triggerAt(static_cast<float>(index + beatDelta) + randomOffset, adjustedPower);
         }
         else
         {
             {
                 const auto randomOffset = getRandomSpread()*beatDelta*0.5f;
-            std::cout << beatDelta << "\t" << randomOffset << std::endl;
-                const auto targetIndex = static_cast<size_t>(index + beatDelta + randomOffset);
-                m_triggerCallback(targetIndex, power, 1);
+                PINGSYNTH_TRACE(TraceKind::Spread, beatDelta, randomOffset);
+                triggerAt(static_cast<float>(index + beatDelta) + randomOffset, power);
             }
             {
                 const auto randomOffset = getRandomSpread()*beatDelta*0.5f;
-                std::cout << beatDelta << "\t" << randomOffset << std::endl;
+                PINGSYNTH_TRACE(TraceKind::Spread, beatDelta, randomOffset);
                 const auto powerVariation =
-                    m_randomPower > 0.0f ? 1.0f + m_getHumanRandomness() * m_randomPower * 0.5f : 1.0f;
+                    m_randomPower > 0.0f ? 1.0f + m_sink.humanRandomness() * m_randomPower * 0.5f : 1.0f;
                 const auto adjustedPower = (m_spread - 0.5f) * 2 * power * powerVariation;
-                const auto targetIndex = static_cast<size_t>(index - beatDelta - randomOffset);
-                m_triggerCallback(targetIndex, adjustedPower, 1);
+                const auto below = static_cast<std::ptrdiff_t>(index) - static_cast<std::ptrdiff_t>(beatDelta);
+                triggerAt(static_cast<float>(below) - randomOffset, adjustedPower);
             }
         }
     }
 
   private:
+    // triggers the slot at the truncated position, copies that fall off either end of the N slots are skipped
+    void triggerAt(const float position, const float power)
+    {
+        if (position >= 0.f && position < static_cast<float>(N))
+        {
+            m_sink.trigger(static_cast<size_t>(position), power, 1.f);
+        }
+    }
+
     const std::array<float, N>& m_frequencies;
-    const std::function<size_t(float)>& m_getFrequencyIndex;
-    const std::function<float()>& m_getHumanRandomness;
-    TriggerCallback m_triggerCallback;
+    const FrequencyIndexMapper& m_getFrequencyIndex;
+    Sink m_sink;
     float m_spread{0.0f};
     float m_randomSpread{0.0f};
     float m_randomPower{0.0f};
-    mutable std::mt19937 m_rng{std::random_device{}()};
 };
\ No newline at end of file
@@ -1,16 +1,26 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
-#include <memory>
-#include <random>
-#include <numbers>
-#include <functional>
+#include <cmath>
+#include <cstdint>
+#include <span>
 
 #include "PingHarmonics.h"
 #include "PingSpread.h"
+#include "RandomPool.h"
 #include "ResoGenerator.h"
 
-template <size_t BlockSize>
+// where the resonators of a voice sit across the outputs, scaled by the pan width
+enum class PanMode
+{
+    Center,
+    Frequency,  // low slots towards the first output, high slots towards the last
+    SpreadSide, // beating copies above the partial to one side, below it to the other
+    Random,
+};
+
+template <size_t BlockSize, size_t NumOutputs = 1>
 class PingSynth
 {
     static constexpr int minMidiNote{17};
@@ -18,88 +28,24 @@ class PingSynth
     static constexpr int range{maxMidiNote - minMidiNote};
     static constexpr int stepsPerSemitone{66};
 
+  public:
+    // resonator slots, minMidiNote ... maxMidiNote at stepsPerSemitone slots per semitone
     static constexpr size_t NumElements{range * (stepsPerSemitone) + 1};
 
-  public:
+    using OutputBlock = typename ResoGenerator<BlockSize, NumElements, NumOutputs>::OutputBlock;
+
     explicit PingSynth(const float sampleRate)
         : m_sampleRate(sampleRate)
-        , m_triggerCallback(
-              [this](const size_t index, const float power, float order)
-              {
-                  size_t wait = 0;
-                  if (m_sparkleRandom == 0.f || order == 0.f)
-                  {
-                      if (m_sparkleTimeBlocks < 0)
-                      {
-                          wait = static_cast<size_t>((1 - order) * -m_sparkleTimeBlocks);
-                      }
-                      else
-                      {
-                          wait = static_cast<size_t>(order * m_sparkleTimeBlocks);
-                      }
-                  }
-                  else
-                  {
-                      std::uniform_real_distribution dist(0.f, 1.f);
-                      const auto u = dist(m_randomGenerator);
-                      if (m_sparkleTimeBlocks >= 0)
-                      {
-                          const auto interpolatedValue = (1.f - m_sparkleRandom) * order + m_sparkleRandom * u;
-                          wait = static_cast<size_t>(interpolatedValue * m_sparkleTimeBlocks);
-                      }
-                      else
-                      {
-                          const auto interpolatedValue = (1.f - m_sparkleRandom) * (1 - order) + m_sparkleRandom * u;
-                          wait = static_cast<size_t>(interpolatedValue * -m_sparkleTimeBlocks);
-                      }
-                  }
-                  m_resoEngine.triggerNew(index, power, wait);
-              })
-        , m_getFrequencyIndexFunc(
-              [this](const float targetFreq) -> size_t
-              {
-                  const auto baseFrequency = 440.0f * std::pow(2.0f, static_cast<float>(minMidiNote - 69) / 12.0f);
-                  constexpr auto slotsPerOctave = static_cast<float>(stepsPerSemitone) * 12.0f;
-                  const auto exactIndex = std::log2(targetFreq / baseFrequency) * slotsPerOctave;
-                  const auto roundedIndex = static_cast<size_t>(std::round(exactIndex));
-                  return std::clamp(roundedIndex, size_t{0}, m_frequencies.size() - 1);
-              })
-        , m_getRandomnessFunc(
-              [this]() -> float
-              {
-                  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
-                  const auto u1 = uniform(m_randomGenerator);
-                  const auto u2 = uniform(m_randomGenerator);
-                  const auto gaussian =
-                      std::sqrt(-2.0f * std::log(u1)) * std::cos(2.0f * std::numbers::pi_v<float> * u2);
-                  return std::clamp(gaussian * 0.3f, -1.0f, 1.0f);
-              })
-        , m_spreadCallback(
-              [this](const size_t index, const float power)
-              {
-                  if (m_spreadGenerator)
-                  {
-                      m_spreadGenerator->generateSpreads(index, power);
-                  }
-              })
+        , m_frequencyIndexMapper(440.0f * std::pow(2.0f, static_cast<float>(minMidiNote - 69) / 12.0f),
+                                 static_cast<float>(stepsPerSemitone) * 12.0f, NumElements)
+        , m_spreadGenerator(m_frequencies, m_frequencyIndexMapper, GeneratorSink{this})
+        , m_oddGenerator(m_frequencies, m_frequencyIndexMapper, GeneratorSink{this}, m_currentVelocity, m_randomPower)
+        , m_evenGenerator(m_frequencies, m_frequencyIndexMapper, GeneratorSink{this}, m_currentVelocity, m_randomPower)
+        , m_stretchedGenerator(m_frequencies, m_frequencyIndexMapper, GeneratorSink{this}, m_currentVelocity,
+                               m_randomPower)
         , m_resoEngine(sampleRate, minMidiNote, stepsPerSemitone)
     {
         m_frequencies = m_resoEngine.getFrequencies();
-
-        m_spreadGenerator = std::make_unique<PingSpread<NumElements, stepsPerSemitone>>(
-            m_frequencies, m_getFrequencyIndexFunc, m_getRandomnessFunc, m_triggerCallback);
-
-        m_oddGenerator = std::make_unique<OddHarmonicGenerator<NumElements>>(
-            m_frequencies, m_getFrequencyIndexFunc, m_getRandomnessFunc, m_currentVelocity, m_randomPower,
-            m_triggerCallback, m_spreadCallback);
-
-        m_evenGenerator = std::make_unique<EvenHarmonicGenerator<NumElements>>(
-            m_frequencies, m_getFrequencyIndexFunc, m_getRandomnessFunc, m_currentVelocity, m_randomPower,
-            m_triggerCallback, m_spreadCallback);
-
-        m_stretchedGenerator = std::make_unique<StretchedHarmonicGenerator<NumElements>>(
-            m_frequencies, m_getFrequencyIndexFunc, m_getRandomnessFunc, m_currentVelocity, m_randomPower,
-            m_triggerCallback, m_spreadCallback);
     }
 
     void setDecay(const float decay) noexcept
@@ -115,43 +61,43 @@ class PingSynth
 
     void setSpread(const float spread) noexcept
     {
-        m_spreadGenerator->setSpread(spread);
+        m_spreadGenerator.setSpread(spread);
     }
 
     void setOddsOvertones(const float value) noexcept
     {
-        m_oddGenerator->setOdds(value);
+        m_oddGenerator.setOdds(value);
     }
 
     void setEvenOvertones(const float value) noexcept
     {
-        m_evenGenerator->setEvens(value);
+        m_evenGenerator.setEvens(value);
     }
 
     void setStretchedOvertones(const float value) noexcept
     {
-        m_stretchedGenerator->setStretched(value);
+        m_stretchedGenerator.setStretched(value);
     }
 
     void setSkewOddOvertones(const float value)
     {
-        m_oddGenerator->setSkewOdds(value);
+        m_oddGenerator.setSkewOdds(value);
     }
 
     void setSkewEvenOvertones(const float value)
     {
-        m_evenGenerator->setSkewEvens(value);
+        m_evenGenerator.setSkewEvens(value);
     }
 
     void setRandomSpread(const float value)
     {
-        m_spreadGenerator->setRandomSpread(value);
+        m_spreadGenerator.setRandomSpread(value);
     }
 
     void setRandomPower(const float value)
     {
         m_randomPower = value;
-        m_spreadGenerator->setRandomPower(value);
+        m_spreadGenerator.setRandomPower(value);
     }
 
     void setExcitationNoise(const float value)
@@ -159,6 +105,67 @@ class PingSynth
         m_resoEngine.setExcitationNoise(value);
     }
 
+    void setRenderThreads(const size_t numThreads, const bool pinToCores = false)
+    {
+        m_resoEngine.setRenderThreads(numThreads, pinToCores);
+    }
+
+    [[nodiscard]] size_t renderThreads() const noexcept
+    {
+        return m_resoEngine.renderThreads();
+    }
+
+    void setMultirate(const bool enable)
+    {
+        m_resoEngine.setMultirate(enable);
+    }
+
+    void setAudibilityFloor(const float dBFS)
+    {
+        m_resoEngine.setAudibilityFloor(dBFS);
+    }
+
+    void setMaxActiveResonators(const size_t count)
+    {
+        m_resoEngine.setMaxActiveResonators(count);
+    }
+
+    void setExcitationCache(const size_t maxBytes)
+    {
+        m_resoEngine.setExcitationCache(maxBytes);
+    }
+
+    void setExcitationShape(const ExcitationShape shape)
+    {
+        m_resoEngine.setExcitationShape(shape);
+    }
+
+    void prepareExcitationCache()
+    {
+        m_resoEngine.prepareExcitationCache();
+    }
+
+    bool loadExcitationSample(const std::span<const float> samples)
+    {
+        return m_resoEngine.loadExcitationSample(samples);
+    }
+
+    void setCollisionPolicy(const CollisionPolicy policy)
+    {
+        m_resoEngine.setCollisionPolicy(policy);
+    }
+
+    void setPanMode(const PanMode mode)
+    {
+        m_panMode = mode;
+    }
+
+    // 0 keeps every resonator centred, 1 uses the full width between the first and the last output
+    void setPanWidth(const float width)
+    {
+        m_panWidth = std::clamp(width, 0.f, 1.f);
+    }
+
     void setSparkleTime(const float ms)
     {
         m_sparkleTimeBlocks = static_cast<int>(ms * 0.001f * m_sampleRate / BlockSize);
@@ -172,48 +179,76 @@ class PingSynth
     void setMinOvertones(const int overtones)
     {
         m_overtoneCount.first = overtones;
-        m_oddGenerator->setMinMaxOvertone(m_overtoneCount);
-        m_evenGenerator->setMinMaxOvertone(m_overtoneCount);
-        m_stretchedGenerator->setMinMaxOvertone(m_overtoneCount);
+        m_oddGenerator.setMinMaxOvertone(m_overtoneCount);
+        m_evenGenerator.setMinMaxOvertone(m_overtoneCount);
+        m_stretchedGenerator.setMinMaxOvertone(m_overtoneCount);
     }
 
     void setMaxOvertones(const int overtones)
     {
         m_overtoneCount.second = overtones;
-        m_oddGenerator->setMinMaxOvertone(m_overtoneCount);
-        m_evenGenerator->setMinMaxOvertone(m_overtoneCount);
-        m_stretchedGenerator->setMinMaxOvertone(m_overtoneCount);
+        m_oddGenerator.setMinMaxOvertone(m_overtoneCount);
+        m_evenGenerator.setMinMaxOvertone(m_overtoneCount);
+        m_stretchedGenerator.setMinMaxOvertone(m_overtoneCount);
     }
 
     void triggerSingleSlot(const size_t index, const float power) noexcept
     {
-        m_triggerCallback(index, power, 0);
+        triggerResonator(index, power, 0.f);
     }
 
     void triggerSlots(const size_t index, const float power) noexcept
     {
-        triggerSingleSlot(index, power);
-        m_spreadGenerator->generateSpreads(index, power);
-        m_oddGenerator->generateHarmonics(index, power);
-        m_evenGenerator->generateHarmonics(index, power);
-        m_stretchedGenerator->generateHarmonics(index, power);
+        m_overtones.size = 0;
+        appendOvertones(index, power);
+        triggerOvertones(index, power, 0, m_overtones.size);
     }
 
-    void triggerVoice(const size_t height, const float velocity) noexcept
+    // sampleOffset: position of the note-on inside the next block
+    void triggerVoice(const size_t height, const float velocity, const size_t sampleOffset = 0) noexcept
     {
-        std::cout << "\n" << height << "\t" << m_frequencies[height] << std::endl;
-        if (height < minMidiNote || height > maxMidiNote)
+        const NoteOn note{height, velocity, sampleOffset};
+        triggerChord({&note, 1});
+    }
+
+    struct NoteOn
+    {
+        size_t height;
+        float velocity;
+        size_t sampleOffset;
+    };
+
+    // note-ons of one block: the overtones of up to OvertoneBatch::MaxNotes notes are generated in one pass, then
+    // triggered note by note; larger chords take several passes, no note is dropped
+    void triggerChord(const std::span<const NoteOn> notes) noexcept
+    {
+        size_t next = 0;
+        while (next < notes.size())
         {
-            return;
+            m_overtones.size = 0;
+            size_t numPrepared = 0;
+            // m_chord holds as many notes as the batch has room for, see the static_assert at its declaration
+            while (next < notes.size() && numPrepared < m_chord.size())
+            {
+                if (prepareNote(notes[next], m_chord[numPrepared]))
+                {
+                    ++numPrepared;
+                }
+                ++next;
+            }
+            for (size_t n = 0; n < numPrepared; ++n)
+            {
+                const auto& note = m_chord[n];
+                m_triggerOffset = note.sampleOffset;
+                m_triggerOwner = static_cast<uint8_t>(note.height);
+                triggerOvertones(note.baseIndex, note.power, note.begin, note.end);
+            }
+            m_triggerOffset = 0;
+            m_triggerOwner = ResoGenerator<BlockSize, NumElements, NumOutputs>::NoOwner;
         }
-        m_countVoices++;
-        const auto relHeight = height - minMidiNote;
-        const auto baseIdx = relHeight * stepsPerSemitone;
-        const auto power = velocity * 20.f * (m_decay + 0.01f);
-        m_currentVelocity = velocity;
-        triggerSlots(baseIdx, power);
     }
 
+    // damps the resonators the note triggered, or defers that to the sustain pedal release
     void stopVoice(const size_t height, const float /*velocity*/) noexcept
     {
         if (height < minMidiNote || height > maxMidiNote)
@@ -221,9 +256,40 @@ class PingSynth
             return;
         }
         m_countVoices--;
-        if (m_countVoices == 0)
+        if (!m_noteOffDamping)
         {
+            return;
         }
+        if (m_sustain)
+        {
+            m_sustained[height] = true;
+            return;
+        }
+        m_resoEngine.dampOwner(static_cast<uint8_t>(height));
+    }
+
+    // CC64, releasing it damps the notes let go while it was down
+    void setSustain(const bool down) noexcept
+    {
+        m_sustain = down;
+        if (down)
+        {
+            return;
+        }
+        for (size_t note = 0; note < m_sustained.size(); ++note)
+        {
+            if (m_sustained[note])
+            {
+                m_sustained[note] = false;
+                m_resoEngine.dampOwner(static_cast<uint8_t>(note));
+            }
+        }
+    }
+
+    // on: a note-off (or the CC64 release) damps the resonators of its note; off (the default): notes ring out
+    void setNoteOffDamping(const bool enable) noexcept
+    {
+        m_noteOffDamping = enable;
     }
 
     void setDamper(int value)
@@ -231,29 +297,171 @@ class PingSynth
         m_resoEngine.setDampMode(value > 63 ? false : true);
     }
 
+    // same seed, same parameters and same MIDI give the same output
+    void setRandomSeed(const uint64_t seed)
+    {
+        m_random.setSeed(seed);
+        m_resoEngine.setNoiseSeed(seed);
+    }
+
     void processBlock(std::array<float, BlockSize>& out) noexcept
+        requires(NumOutputs == 1)
     {
+        m_random.refill();
+        m_resoEngine.processBlock(out);
+    }
+
+    void processBlock(OutputBlock& out) noexcept
+    {
+        m_random.refill();
         m_resoEngine.processBlock(out);
     }
 
   private:
-    float getHumanRandomness() const noexcept
+    // a note of the chord being triggered, its overtones are m_overtones[begin, end)
+    struct PreparedNote
+    {
+        size_t height;
+        size_t baseIndex;
+        float power;
+        size_t sampleOffset;
+        size_t begin;
+        size_t end;
+    };
+
+    bool prepareNote(const NoteOn& noteOn, PreparedNote& note) noexcept
     {
-        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
-        const auto u1 = uniform(m_randomGenerator);
-        const auto u2 = uniform(m_randomGenerator);
-        const auto gaussian = std::sqrt(-2.0f * std::log(u1)) * std::cos(2.0f * std::numbers::pi_v<float> * u2);
-        return std::clamp(gaussian * 0.3f, -1.0f, 1.0f);
+        if (noteOn.height < minMidiNote || noteOn.height > maxMidiNote)
+        {
+            return false;
+        }
+        m_countVoices++;
+        const auto relHeight = noteOn.height - minMidiNote;
+        note.height = noteOn.height;
+        note.baseIndex = relHeight * stepsPerSemitone;
+        PINGSYNTH_TRACE(TraceKind::VoiceTrigger, noteOn.height, m_frequencies[note.baseIndex]);
+        note.power = noteOn.velocity * 20.f * (m_decay + 0.01f);
+        note.sampleOffset = noteOn.sampleOffset;
+        m_currentVelocity = noteOn.velocity;
+        m_sustained[noteOn.height] = false;
+        note.begin = m_overtones.size;
+        appendOvertones(note.baseIndex, note.power);
+        note.end = m_overtones.size;
+        return true;
     }
 
+    void appendOvertones(const size_t index, const float power) noexcept
+    {
+        m_oddGenerator.generateHarmonics(index, power, m_overtones);
+        m_evenGenerator.generateHarmonics(index, power, m_overtones);
+        m_stretchedGenerator.generateHarmonics(index, power, m_overtones);
+    }
 
-    size_t getFrequencyIndex(const float targetFreq) const noexcept
+    // the slot itself and its spreads, then the overtones m_overtones[begin, end) of it
+    void triggerOvertones(const size_t index, const float power, const size_t begin, const size_t end) noexcept
+    {
+        triggerSingleSlot(index, power);
+        generateSpreads(index, power);
+        for (size_t k = begin; k < end; ++k)
+        {
+            const auto overtonePower = m_overtones.power[k];
+            if (overtonePower > 0.001f)
+            {
+                triggerResonator(m_overtones.index[k], overtonePower, m_overtones.order[k]);
+                if (m_overtones.spread[k])
+                {
+                    generateSpreads(m_overtones.index[k], overtonePower);
+                }
+            }
+        }
+    }
+
+    // the randomness of the generators and the triggers of PingSpread, see PingHarmonics.h and PingSpread.h
+    struct GeneratorSink
+    {
+        PingSynth* synth;
+
+        void trigger(const size_t index, const float power, const float order) const noexcept
+        {
+            synth->triggerResonator(index, power, order);
+        }
+
+        [[nodiscard]] float humanRandomness() const noexcept
+        {
+            return synth->getHumanRandomness();
+        }
+
+        [[nodiscard]] float uniform() const noexcept
+        {
+            return synth->m_random.uniform();
+        }
+    };
+
+    // order in [0, 1] places the trigger inside the sparkle time
+    void triggerResonator(const size_t index, const float power, const float order) noexcept
+    {
+        size_t wait = 0;
+        if (m_sparkleRandom == 0.f || order == 0.f)
+        {
+            if (m_sparkleTimeBlocks < 0)
+            {
+                wait = static_cast<size_t>((1 - order) * -m_sparkleTimeBlocks);
+            }
+            else
+            {
+                wait = static_cast<size_t>(order * m_sparkleTimeBlocks);
+            }
+        }
+        else
+        {
+            const auto u = m_random.uniform();
+            if (m_sparkleTimeBlocks >= 0)
+            {
+                const auto interpolatedValue = (1.f - m_sparkleRandom) * order + m_sparkleRandom * u;
+                wait = static_cast<size_t>(interpolatedValue * m_sparkleTimeBlocks);
+            }
+            else
+            {
+                const auto interpolatedValue = (1.f - m_sparkleRandom) * (1 - order) + m_sparkleRandom * u;
+                wait = static_cast<size_t>(interpolatedValue * -m_sparkleTimeBlocks);
+            }
+        }
+        m_resoEngine.triggerNew(index, power, wait, m_triggerOffset, panPosition(index), m_triggerOwner);
+    }
+
+    // remembers the partial being spread, so the trigger callback can tell on which side a copy lands
+    void generateSpreads(const size_t index, const float power) noexcept
+    {
+        m_spreadSource = index;
+        m_spreadGenerator.generateSpreads(index, power);
+        m_spreadSource = NoSpreadSource;
+    }
+
+    float panPosition(const size_t index) const noexcept
+    {
+        switch (m_panMode)
+        {
+            case PanMode::Center:
+                break;
+            case PanMode::Frequency:
+                return 0.5f + m_panWidth * (static_cast<float>(index) / static_cast<float>(NumElements - 1) - 0.5f);
+            case PanMode::SpreadSide:
+                if (m_spreadSource != NoSpreadSource)
+                {
+                    return index > m_spreadSource ? 0.5f + 0.5f * m_panWidth : 0.5f - 0.5f * m_panWidth;
+                }
+                break;
+            case PanMode::Random:
+            {
+                return 0.5f + m_panWidth * (m_random.uniform() - 0.5f);
+            }
+        }
+        return 0.5f;
+    }
+
+    float getHumanRandomness() const noexcept
     {
-        const auto baseFrequency = 440.0f * std::pow(2.0f, static_cast<float>(minMidiNote - 69) / 12.0f);
-        constexpr auto slotsPerOctave = static_cast<float>(stepsPerSemitone) * 12.0f;
-        const auto exactIndex = std::log2(targetFreq / baseFrequency) * slotsPerOctave;
-        const auto roundedIndex = static_cast<size_t>(std::round(exactIndex));
-        return std::clamp(roundedIndex, size_t{0}, m_frequencies.size() - 1);
+        return std::clamp(m_random.gaussian() * 0.3f, -1.0f, 1.0f);
     }
 
     float m_sampleRate;
@@ -263,19 +471,30 @@ class PingSynth
     int m_sparkleTimeBlocks{0};
     float m_sparkleRandom{0};
     float m_decay{0.f};
+    size_t m_triggerOffset{0};
+    uint8_t m_triggerOwner{ResoGenerator<BlockSize, NumElements, NumOutputs>::NoOwner};
+    bool m_sustain{false};
+    bool m_noteOffDamping{false};
+    std::array<bool, maxMidiNote + 1> m_sustained{};
+    static constexpr size_t NoSpreadSource{~size_t{0}};
+    size_t m_spreadSource{NoSpreadSource};
+    PanMode m_panMode{PanMode::Center};
+    float m_panWidth{1.f};
 
     std::array<float, NumElements> m_frequencies{};
 
-    mutable std::mt19937 m_randomGenerator{std::random_device{}()};
+    mutable RandomPool m_random;
 
-    std::function<void(size_t, float, float)> m_triggerCallback;
-    std::function<size_t(float)> m_getFrequencyIndexFunc;
-    std::function<float()> m_getRandomnessFunc;
-    std::function<void(size_t, float)> m_spreadCallback;
+    FrequencyIndexMapper m_frequencyIndexMapper;
     std::pair<int, int> m_overtoneCount;
-    std::unique_ptr<PingSpread<NumElements, stepsPerSemitone>> m_spreadGenerator;
-    std::unique_ptr<OddHarmonicGenerator<NumElements>> m_oddGenerator;
-    std::unique_ptr<EvenHarmonicGenerator<NumElements>> m_evenGenerator;
-    std::unique_ptr<StretchedHarmonicGenerator<NumElements>> m_stretchedGenerator;
-    ResoGenerator<BlockSize, NumElements> m_resoEngine;
+    PingSpread<NumElements, stepsPerSemitone, GeneratorSink> m_spreadGenerator;
+    OddHarmonicGenerator<NumElements, GeneratorSink> m_oddGenerator;
+    EvenHarmonicGenerator<NumElements, GeneratorSink> m_evenGenerator;
+    StretchedHarmonicGenerator<NumElements, GeneratorSink> m_stretchedGenerator;
+    static constexpr size_t MaxChordNotes{OvertoneBatch::MaxNotes};
+    static_assert(MaxChordNotes * OvertoneBatch::NumGenerators * MaxOvertones <= OvertoneBatch::Capacity,
+                  "every note of a pass must fit the overtone batch");
+    OvertoneBatch m_overtones;
+    std::array<PreparedNote, MaxChordNotes> m_chord{};
+    ResoGenerator<BlockSize, NumElements, NumOutputs> m_resoEngine;
 };
\ No newline at end of file
@@ -5,19 +5,28 @@
 #include "Audio/AudioBuffer.h"
 #include "PingSynth.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
 #include <cstdint>
 #include <cmath>
 #include <functional>
+#include <span>
+#include <vector>
 
 template <size_t BlockSize>
 class PingSynthExplorerPedal final : public EffectBase
 {
   public:
     static constexpr size_t NumChannels{2};
-    PingSynthExplorerPedal(const float sampleRate)
+    static constexpr size_t MaxMidiBytes{3};
+
+    // maxHostBlockSize sizes the MIDI queue, see scheduleMidi()
+    explicit PingSynthExplorerPedal(const float sampleRate, const size_t maxHostBlockSize = 1024)
         : EffectBase(sampleRate)
         , m_ping(sampleRate)
+        , m_midiEvents(std::bit_ceil(std::max<size_t>(2 * (maxHostBlockSize + BlockSize), 1024)))
     {
     }
 
@@ -115,7 +124,180 @@ class PingSynthExplorerPedal final : public EffectBase
         m_ping.setMaxOvertones(value);
     }
 
+    void setRenderThreads(const size_t numThreads, const bool pinToCores = false)
+    {
+        m_ping.setRenderThreads(numThreads, pinToCores);
+    }
+
+    [[nodiscard]] size_t renderThreads() const noexcept
+    {
+        return m_ping.renderThreads();
+    }
+
+    void setRandomSeed(const uint64_t seed)
+    {
+        m_ping.setRandomSeed(seed);
+    }
+
+    void setMultirate(const bool enable)
+    {
+        m_ping.setMultirate(enable);
+    }
+
+    void setNoteOffDamping(const bool enable)
+    {
+        m_ping.setNoteOffDamping(enable);
+    }
+
+    void setCollisionPolicy(const CollisionPolicy policy)
+    {
+        m_ping.setCollisionPolicy(policy);
+    }
+
+    void setPanMode(const PanMode mode)
+    {
+        m_ping.setPanMode(mode);
+    }
+
+    void setPanWidth(const float width)
+    {
+        m_ping.setPanWidth(width);
+    }
+
+    void setAudibilityFloor(const float dBFS)
+    {
+        m_ping.setAudibilityFloor(dBFS);
+    }
+
+    void setMaxActiveResonators(const size_t count)
+    {
+        m_ping.setMaxActiveResonators(count);
+    }
+
+    void setExcitationCache(const size_t maxBytes)
+    {
+        m_ping.setExcitationCache(maxBytes);
+    }
+
+    void setExcitationShape(const ExcitationShape shape)
+    {
+        m_ping.setExcitationShape(shape);
+    }
+
+    // renders the burst cache for the current excitation, outside the audio callback
+    void prepareExcitationCache()
+    {
+        m_ping.prepareExcitationCache();
+    }
+
+    bool loadExcitationSample(const std::span<const float> samples)
+    {
+        return m_ping.loadExcitationSample(samples);
+    }
+
     [[maybe_unused]] void processMidi(const uint8_t* msg) override
+    {
+        handleMidi(msg, 0);
+    }
+
+    /*
+     * Queues a channel message stamped with its absolute sample time, it is dispatched in the block covering
+     * that time. Messages longer than MaxMidiBytes (SysEx) are rejected and counted, shorter ones are padded with
+     * zeros. The queue holds one event per sample of two host blocks; should it still fill up, the queued events
+     * are dispatched at once, early but in order, so a note-off is never lost. Call it from the audio thread.
+     */
+    bool scheduleMidi(const uint8_t* msg, const size_t numBytes, const uint64_t sampleTime)
+    {
+        if (numBytes == 0 || numBytes > MaxMidiBytes)
+        {
+            ++m_rejectedMidi;
+            return false;
+        }
+        if (m_midiWrite - m_midiRead == m_midiEvents.size())
+        {
+            m_earlyMidi += m_midiWrite - m_midiRead;
+            dispatchMidi(UINT64_MAX);
+        }
+        auto& event = m_midiEvents[m_midiWrite++ & (m_midiEvents.size() - 1)];
+        event.time = sampleTime;
+        event.data.fill(0);
+        std::copy_n(msg, numBytes, event.data.begin());
+        return true;
+    }
+
+    // messages scheduleMidi() rejected for their length
+    [[nodiscard]] size_t rejectedMidiEvents() const noexcept
+    {
+        return m_rejectedMidi;
+    }
+
+    // events dispatched ahead of their time because the MIDI queue was full
+    [[nodiscard]] size_t earlyMidiEvents() const noexcept
+    {
+        return m_earlyMidi;
+    }
+
+    void processBlock(const AbacDsp::AudioBuffer<NumChannels, BlockSize>& in,
+                      AbacDsp::AudioBuffer<NumChannels, BlockSize>& out)
+    {
+        dispatchMidi(m_blockTime + BlockSize);
+        renderBlock(in, out);
+        m_blockTime += BlockSize;
+    }
+
+  private:
+    struct MidiEvent
+    {
+        uint64_t time;
+        std::array<uint8_t, MaxMidiBytes> data;
+    };
+
+    // dispatches the events before time end, at their offset when they fall into the coming block and at its
+    // start otherwise; note-ons in a row are triggered as one chord, any other message first flushes the chord
+    // so the order holds
+    void dispatchMidi(const uint64_t end)
+    {
+        size_t numNotes = 0;
+        for (; m_midiRead != m_midiWrite; ++m_midiRead)
+        {
+            const auto* event = &m_midiEvents[m_midiRead & (m_midiEvents.size() - 1)];
+            if (event->time >= end)
+            {
+                break;
+            }
+            const auto offset = event->time > m_blockTime && event->time < m_blockTime + BlockSize
+                                    ? static_cast<size_t>(event->time - m_blockTime)
+                                    : 0;
+            const auto* msg = event->data.data();
+            if ((msg[0] & 0xF0) == 0x90 && msg[2] != 0)
+            {
+                if (numNotes == m_chord.size())
+                {
+                    triggerChord(numNotes);
+                }
+                m_chord[numNotes++] = {msg[1], msg[2] / 127.f, offset};
+            }
+            else
+            {
+                triggerChord(numNotes);
+                handleMidi(msg, offset);
+            }
+        }
+        triggerChord(numNotes);
+    }
+
+    void triggerChord(size_t& numNotes)
+    {
+        if (numNotes == 0)
+        {
+            return;
+        }
+        m_ping.setDamper(127); // reset damper, just in case
+        m_ping.triggerChord({m_chord.data(), numNotes});
+        numNotes = 0;
+    }
+
+    void handleMidi(const uint8_t* msg, const size_t sampleOffset)
     {
         switch (msg[0] & 0xF0)
         {
@@ -123,7 +305,7 @@ class PingSynthExplorerPedal final : public EffectBase
                 if (msg[2] != 0)
                 {
                     m_ping.setDamper(127); // reset damper, just in case
-                    m_ping.triggerVoice(msg[1], msg[2] / 127.f);
+                    m_ping.triggerVoice(msg[1], msg[2] / 127.f, sampleOffset);
                 }
                 else
                 {
@@ -134,6 +316,10 @@ class PingSynthExplorerPedal final : public EffectBase
                 m_ping.stopVoice(msg[1], msg[2] / 127.f);
                 break;
             case 0xB0:
+                if (msg[1] == 64)
+                {
+                    m_ping.setSustain(msg[2] >= 64);
+                }
                 if (msg[1] == 120)
                 {
                     m_ping.setDamper(msg[2]);
@@ -148,8 +334,8 @@ class PingSynthExplorerPedal final : public EffectBase
         }
     }
 
-    void processBlock(const AbacDsp::AudioBuffer<NumChannels, BlockSize>& in,
-                      AbacDsp::AudioBuffer<NumChannels, BlockSize>& out)
+    void renderBlock(const AbacDsp::AudioBuffer<NumChannels, BlockSize>& in,
+                     AbacDsp::AudioBuffer<NumChannels, BlockSize>& out)
     {
         for (size_t i = 0; i < BlockSize; ++i)
         {
@@ -157,19 +343,26 @@ class PingSynthExplorerPedal final : public EffectBase
             out(i, 1) = in(i, 1);
         }
 
-        std::array<float, BlockSize> tmp{};
+        typename PingSynth<BlockSize, NumChannels>::OutputBlock tmp;
         m_ping.processBlock(tmp);
         for (size_t i = 0; i < BlockSize; ++i)
         {
-            out(i, 0) += tmp[i] * m_vol;
-            out(i, 1) += tmp[i] * m_vol;
+            out(i, 0) += tmp[0][i] * m_vol;
+            out(i, 1) += tmp[1][i] * m_vol;
         }
     }
 
-  private:
     size_t m_reload{};
     float m_preset{};
     float m_vol{};
     float m_reverbLevel{};
-    PingSynth<BlockSize> m_ping;
+    PingSynth<BlockSize, NumChannels> m_ping;
+    // scheduleMidi() and processBlock() share the audio thread, a plain power of two ring does
+    std::vector<MidiEvent> m_midiEvents;
+    size_t m_midiRead{0};
+    size_t m_midiWrite{0};
+    size_t m_rejectedMidi{0};
+    size_t m_earlyMidi{0};
+    std::array<typename PingSynth<BlockSize, NumChannels>::NoteOn, 16> m_chord{};
+    uint64_t m_blockTime{0};
 };
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+
+/*
+ * Seedable source of uniform and gaussian variates for the humanization paths. Each pool is refilled from
+ * its own xoshiro128+ generator running Lanes independent streams side by side, so a refill is a vector
+ * loop, and the gaussians come from Box-Muller pairs computed there rather than per draw. refill() tops
+ * both pools up at block boundaries; a draw from an empty pool refills in place. Values are consumed in
+ * generation order, so the sequence only depends on the seed, not on when refills happen. No allocation.
+ */
+class RandomPool
+{
+  public:
+    static constexpr uint64_t DefaultSeed{0x5EEDull};
+    static constexpr size_t Lanes{8};
+    static constexpr size_t PoolSize{512};
+    static_assert(PoolSize % (2 * Lanes) == 0);
+
+    explicit RandomPool(const uint64_t seed = DefaultSeed) noexcept
+    {
+        setSeed(seed);
+    }
+
+    void setSeed(uint64_t seed) noexcept
+    {
+        m_uniformStream.seed(seed);
+        m_gaussianStream.seed(seed);
+        m_uniform.clear();
+        m_gaussian.clear();
+        refill();
+    }
+
+    // [0, 1)
+    [[nodiscard]] float uniform() noexcept
+    {
+        if (m_uniform.empty())
+        {
+            refillUniform();
+        }
+        return m_uniform.pop();
+    }
+
+    // standard normal
+    [[nodiscard]] float gaussian() noexcept
+    {
+        if (m_gaussian.empty())
+        {
+            refillGaussian();
+        }
+        return m_gaussian.pop();
+    }
+
+    void refill() noexcept
+    {
+        refillUniform();
+        refillGaussian();
+    }
+
+  private:
+    using Block = std::array<uint32_t, Lanes>;
+
+    struct Stream
+    {
+        std::array<Block, 4> s;
+
+        // splitmix64 expansion of the seed, it also advances seed so the next stream gets different state
+        void seed(uint64_t& seed) noexcept
+        {
+            for (auto& word : s)
+            {
+                for (auto& lane : word)
+                {
+                    seed += 0x9E3779B97F4A7C15ull;
+                    auto z = seed;
+                    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                    lane = static_cast<uint32_t>((z ^ (z >> 31)) >> 32);
+                }
+            }
+        }
+
+        void next(Block& out) noexcept
+        {
+            auto& [s0, s1, s2, s3] = s;
+            for (size_t l = 0; l < Lanes; ++l)
+            {
+                out[l] = s0[l] + s3[l];
+                const auto t = s1[l] << 9;
+                s2[l] ^= s0[l];
+                s3[l] ^= s1[l];
+                s1[l] ^= s2[l];
+                s0[l] ^= s3[l];
+                s2[l] ^= t;
+                s3[l] = (s3[l] << 11) | (s3[l] >> 21);
+            }
+        }
+    };
+
+    struct Pool
+    {
+        std::array<float, PoolSize> values;
+        size_t read{0};
+        size_t size{0};
+
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return read == size;
+        }
+
+        float pop() noexcept
+        {
+            return values[read++];
+        }
+
+        void clear() noexcept
+        {
+            read = size = 0;
+        }
+
+        // moves the unread values to the front, returns where new ones go; room is a multiple of groupSize
+        float* compact(const size_t groupSize, size_t& room) noexcept
+        {
+            std::copy(values.begin() + read, values.begin() + size, values.begin());
+            size -= read;
+            read = 0;
+            room = (PoolSize - size) / groupSize * groupSize;
+            return values.data() + size;
+        }
+    };
+
+    // top 24 bits to [0, 1), offset by one ulp when zero must be excluded
+    static float toUnit(const uint32_t bits, const float offset) noexcept
+    {
+        return (static_cast<float>(static_cast<int32_t>(bits >> 8)) + offset) * (1.f / 16777216.f);
+    }
+
+    void refillUniform() noexcept
+    {
+        size_t room;
+        auto* dst = m_uniform.compact(Lanes, room);
+        Block bits;
+        for (size_t k = 0; k < room; k += Lanes)
+        {
+            m_uniformStream.next(bits);
+            for (size_t l = 0; l < Lanes; ++l)
+            {
+                dst[k + l] = toUnit(bits[l], 0.f);
+            }
+        }
+        m_uniform.size += room;
+    }
+
+    void refillGaussian() noexcept
+    {
+        size_t room;
+        auto* dst = m_gaussian.compact(2 * Lanes, room);
+        Block radiusBits;
+        Block angleBits;
+        for (size_t k = 0; k < room; k += 2 * Lanes)
+        {
+            m_gaussianStream.next(radiusBits);
+            m_gaussianStream.next(angleBits);
+            for (size_t l = 0; l < Lanes; ++l)
+            {
+                const auto radius = std::sqrt(-2.f * std::log(toUnit(radiusBits[l], 1.f)));
+                const auto angle = 2.f * std::numbers::pi_v<float> * toUnit(angleBits[l], 0.f);
+                dst[k + l] = radius * std::cos(angle);
+                dst[k + Lanes + l] = radius * std::sin(angle);
+            }
+        }
+        m_gaussian.size += room;
+    }
+
+    Stream m_uniformStream{};
+    Stream m_gaussianStream{};
+    Pool m_uniform{};
+    Pool m_gaussian{};
+};
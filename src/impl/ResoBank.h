@@ -0,0 +1,611 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <numbers>
+#include <utility>
+
+#include "ExcitationBursts.h"
+#include "ExcitationOverflow.h"
+#include "PingExcitation.h"
+
+/*
+ * Structure-of-arrays resonator bank.
+ *
+ * Every slot owns two coefficient sets (0: ringing, 1: damped) in flat per-slot tables, the ringing
+ * resonators are packed into a dense lane array. Coefficients and state of the active lanes live in
+ * separate aligned arrays, and the recursion runs over a whole lane group per sample so the inner loop
+ * maps onto SSE/NEON (8 lanes) or AVX2 (16 lanes) registers.
+ *
+ * The lanes mirror AbacDsp::BiquadResoBP after setByDecay(): the constant 0 dB peak band pass
+ *   H(z) = b0 (1 - z^-2) / (1 + a1 z^-1 + a2 z^-2), b0 = alpha / a0, a1 = -2 cos(w) / a0, a2 = (1 - alpha) / a0
+ * with a0 = 1 + alpha, alpha = (1 - r^2) / (1 + r^2), w = 2 pi f / sampleRate and r = exp(-ln(1000) / (decay *
+ * sampleRate)), the pole radius that decays by 60 dB in the decay time, run as the direct form I recursion
+ * y = b0 (x - x2) - a1 y1 - a2 y2. BiquadResoBP does not expose its coefficients, reading them back from its
+ * impulse response costs an ulp of a1 and audibly detunes the low slots, so computeCoefficients() repeats the
+ * formula in the same float operations; ResoBankTest.matchesBiquadEngine fails when the two drift apart.
+ *
+ * Once the excitation of a lane is over, the resonator is a decaying sinusoid y[n] = Re(z p^n) with p the
+ * filter pole. Such lanes move to a second (phasor) pool that renders a whole block as Re(z * p^i) from a
+ * per lane power table, free of the sample to sample recursion, and advances z by p^BlockSize. A retrigger
+ * moves the lane back into the biquad pool with the equivalent filter state.
+ *
+ * With NumOutputs > 1 every lane carries one gain per output and the lane groups accumulate into one block
+ * per output, the recursion itself runs once per resonator.
+ */
+template <size_t BlockSize, size_t NumElements, size_t NumOutputs = 1>
+class ResoBank
+{
+  public:
+    using OutputBlock = std::array<std::array<float, BlockSize>, NumOutputs>;
+    using ChannelGains = std::array<float, NumOutputs>;
+
+#if defined(__AVX2__) || defined(__AVX__)
+    static constexpr size_t Lanes{16};
+#else
+    static constexpr size_t Lanes{8};
+#endif
+    static constexpr size_t MaxActive{(NumElements + Lanes - 1) / Lanes * Lanes};
+    static constexpr float SilenceThreshold{1E-5f};
+    static constexpr size_t OverflowCursors{128};
+
+    explicit ResoBank(const float sampleRate)
+        : m_sampleRate(sampleRate)
+    {
+        m_laneOfSlot.fill(NoLane);
+        for (size_t slot = 0; slot < NumElements; ++slot)
+        {
+            m_noiseCursor[slot] = Excitation::noiseStart(slot);
+        }
+    }
+
+    void setByDecay(const size_t set, const size_t slot, const float frequency, const float decay) noexcept
+    {
+        m_cosOmega[slot] = std::cos(2.f * std::numbers::pi_v<float> * frequency / m_sampleRate);
+        setDecay(set, slot, decay);
+    }
+
+    void setDecay(const size_t set, const size_t slot, const float decay) noexcept
+    {
+        computeCoefficients(set, slot, decay);
+        if (m_laneOfSlot[slot] != NoLane && set == currentSet(slot))
+        {
+            reloadSlot(slot);
+        }
+    }
+
+    // whole table update in one pass, active lanes are refreshed once at the end
+    void setDecays(const size_t set, const std::array<float, NumElements>& decays) noexcept
+    {
+        for (size_t j = 0; j < NumElements; ++j)
+        {
+            computeCoefficients(set, j, decays[j]);
+        }
+        reloadActiveLanes();
+    }
+
+    void damp(const bool mode) noexcept
+    {
+        if (m_damped == mode)
+        {
+            return;
+        }
+        m_damped = mode;
+        reloadActiveLanes();
+    }
+
+    // true while the slot still takes input, from its own excitation or an overlay
+    [[nodiscard]] bool exciting(const size_t slot) const noexcept
+    {
+        const auto lane = m_laneOfSlot[slot];
+        if (lane == NoLane || (lane & PhasorLane))
+        {
+            return false;
+        }
+        return m_wait[lane] > 0 || m_position[lane] > 0.f || m_overflow.pending(slot);
+    }
+
+    [[nodiscard]] float excitationGain(const size_t slot) const noexcept
+    {
+        const auto lane = m_laneOfSlot[slot];
+        return lane == NoLane || (lane & PhasorLane) ? 0.f : m_gain[lane];
+    }
+
+    // changes the gain of the running excitation without restarting it, false when the slot has none
+    bool setExcitationGain(const size_t slot, const float gain) noexcept
+    {
+        const auto lane = m_laneOfSlot[slot];
+        if (lane == NoLane || (lane & PhasorLane) || (m_wait[lane] == 0 && m_position[lane] <= 0.f))
+        {
+            return false;
+        }
+        m_gain[lane] = gain;
+        return true;
+    }
+
+    // a second excitation for a slot that is still excited, false when the overflow pool is full
+    bool overlay(const size_t slot, const float position, const float advance, const float gain,
+                 const size_t waitBlocks, const size_t startOffset) noexcept
+    {
+        const auto lane = m_laneOfSlot[slot];
+        if (lane == NoLane || (lane & PhasorLane))
+        {
+            return false;
+        }
+        return m_overflow.add(slot, position, advance, gain, waitBlocks, startOffset,
+                              m_noiseCursor[slot] + Excitation::NoiseSize / 2);
+    }
+
+    // damps a single slot on top of the global damp() state, e.g. on the note-off of its owner
+    void dampSlot(const size_t slot, const bool damped) noexcept
+    {
+        if (m_slotDamped[slot] == damped)
+        {
+            return;
+        }
+        m_slotDamped[slot] = damped;
+        if (m_laneOfSlot[slot] != NoLane)
+        {
+            reloadSlot(slot);
+        }
+    }
+
+    void trigger(const size_t slot, const float position, const float advance, const float gain,
+                 const size_t waitBlocks, const size_t startOffset, const ChannelGains& channelGains) noexcept
+    {
+        auto lane = m_laneOfSlot[slot];
+        if (lane != NoLane && (lane & PhasorLane))
+        {
+            lane = phasorToBiquad(lane & ~PhasorLane);
+        }
+        if (lane == NoLane)
+        {
+            lane = static_cast<uint32_t>(m_numActive++);
+            m_laneOfSlot[slot] = lane;
+            m_slot[lane] = static_cast<uint32_t>(slot);
+            m_x1[lane] = m_x2[lane] = m_y1[lane] = m_y2[lane] = 0.f;
+            loadCoefficients(lane, slot);
+        }
+        m_position[lane] = position;
+        m_advance[lane] = advance;
+        m_gain[lane] = gain;
+        m_wait[lane] = static_cast<uint32_t>(waitBlocks);
+        m_startOffset[lane] = static_cast<uint32_t>(startOffset);
+        for (size_t c = 0; c < NumOutputs; ++c)
+        {
+            m_pan[c][lane] = channelGains[c];
+        }
+    }
+
+    template <typename Func>
+    void forEachActiveSlot(Func&& func) const
+    {
+        for (size_t k = 0; k < m_numActive; ++k)
+        {
+            func(static_cast<size_t>(m_slot[k]));
+        }
+        for (size_t f = 0; f < m_numFree; ++f)
+        {
+            func(static_cast<size_t>(m_freeSlot[f]));
+        }
+    }
+
+    [[nodiscard]] size_t activeCount() const noexcept
+    {
+        return m_numActive + m_numFree;
+    }
+
+    // func(slot, amplitude): |z| for phasor lanes, the ringing amplitude or the pending excitation gain,
+    // whichever is larger, for biquad lanes
+    template <typename Func>
+    void forEachActiveLevel(Func&& func) const
+    {
+        for (size_t k = 0; k < m_numActive; ++k)
+        {
+            const auto pending = m_wait[k] > 0 || m_position[k] > 0.f ? m_gain[k] : 0.f;
+            func(static_cast<size_t>(m_slot[k]), std::max(ringingAmplitude(k), pending));
+        }
+        for (size_t f = 0; f < m_numFree; ++f)
+        {
+            func(static_cast<size_t>(m_freeSlot[f]), std::hypot(m_zr[f], m_zi[f]));
+        }
+    }
+
+    // stops a resonator immediately, a later trigger starts it from rest
+    void release(const size_t slot) noexcept
+    {
+        const auto lane = m_laneOfSlot[slot];
+        if (lane == NoLane)
+        {
+            return;
+        }
+        m_laneOfSlot[slot] = NoLane;
+        m_overflow.dropSlot(slot);
+        if (lane & PhasorLane)
+        {
+            removeFreeLane(lane & ~PhasorLane);
+        }
+        else
+        {
+            removeBiquadLane(lane);
+        }
+    }
+
+    void processBlock(OutputBlock& out, const ExcitationBursts<NumElements>& bursts) noexcept
+    {
+        alignas(64) float acc[NumOutputs][BlockSize][Lanes]{};
+        m_overflow.beginBlock();
+
+        for (size_t g = 0; g < m_numActive; g += Lanes)
+        {
+            alignas(64) float x[BlockSize][Lanes]{};
+            fillExcitation(g, x, bursts);
+            if (!m_overflow.empty())
+            {
+                for (size_t l = g; l < std::min(g + Lanes, m_numActive); ++l)
+                {
+                    if (m_overflow.pending(m_slot[l]))
+                    {
+                        m_overflow.render(m_slot[l], &x[0][l - g], BlockSize, Lanes, bursts);
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < BlockSize; ++i)
+            {
+                for (size_t k = 0; k < Lanes; ++k)
+                {
+                    const auto l = g + k;
+                    const auto y = m_b0[l] * (x[i][k] - m_x2[l]) - m_a1[l] * m_y1[l] - m_a2[l] * m_y2[l];
+                    m_x2[l] = m_x1[l];
+                    m_x1[l] = x[i][k];
+                    m_y2[l] = m_y1[l];
+                    m_y1[l] = y;
+                    accumulate(acc, m_pan, i, k, l, y);
+                }
+            }
+        }
+
+        for (size_t g = 0; g < m_numFree; g += Lanes)
+        {
+            for (size_t i = 0; i < BlockSize; ++i)
+            {
+                for (size_t k = 0; k < Lanes; ++k)
+                {
+                    const auto l = g + k;
+                    accumulate(acc, m_freePan, i, k, l, m_zr[l] * m_powRe[i][l] - m_zi[l] * m_powIm[i][l]);
+                }
+            }
+            for (size_t k = 0; k < Lanes; ++k)
+            {
+                const auto l = g + k;
+                const auto zr = m_zr[l] * m_powRe[BlockSize][l] - m_zi[l] * m_powIm[BlockSize][l];
+                m_zi[l] = m_zr[l] * m_powIm[BlockSize][l] + m_zi[l] * m_powRe[BlockSize][l];
+                m_zr[l] = zr;
+            }
+        }
+
+        for (size_t c = 0; c < NumOutputs; ++c)
+        {
+            for (size_t i = 0; i < BlockSize; ++i)
+            {
+                float sum = 0.f;
+                for (size_t k = 0; k < Lanes; ++k)
+                {
+                    sum += acc[c][i][k];
+                }
+                out[c][i] += sum;
+            }
+        }
+        m_overflow.endBlock();
+        retireSilentLanes();
+    }
+
+  private:
+    static constexpr uint32_t NoLane{0xFFFFFFFF};
+    static constexpr uint32_t PhasorLane{0x80000000};
+
+    using LaneGains = std::array<std::array<float, MaxActive>, NumOutputs>;
+
+    static void accumulate(float (&acc)[NumOutputs][BlockSize][Lanes], const LaneGains& gains, const size_t i,
+                           const size_t k, const size_t l, const float y) noexcept
+    {
+        if constexpr (NumOutputs == 1)
+        {
+            acc[0][i][k] += y;
+        }
+        else
+        {
+            for (size_t c = 0; c < NumOutputs; ++c)
+            {
+                acc[c][i][k] += gains[c][l] * y;
+            }
+        }
+    }
+
+    [[nodiscard]] size_t currentSet(const size_t slot) const noexcept
+    {
+        return m_damped || m_slotDamped[slot] ? 1 : 0;
+    }
+
+    // the coefficients of BiquadResoBP::setByDecay(), see the class comment
+    void computeCoefficients(const size_t set, const size_t slot, const float decay) noexcept
+    {
+        const auto r = std::exp(-6.9077553f / (std::max(decay, 1E-4f) * m_sampleRate));
+        const auto alpha = (1.f - r * r) / (1.f + r * r);
+        const auto a0 = 1.f + alpha;
+        m_slotB0[set][slot] = alpha / a0;
+        m_slotA1[set][slot] = -2.f * m_cosOmega[slot] / a0;
+        m_slotA2[set][slot] = (1.f - alpha) / a0;
+    }
+
+    void loadCoefficients(const size_t lane, const size_t slot) noexcept
+    {
+        const auto set = currentSet(slot);
+        m_b0[lane] = m_slotB0[set][slot];
+        m_a1[lane] = m_slotA1[set][slot];
+        m_a2[lane] = m_slotA2[set][slot];
+    }
+
+    void reloadSlot(const size_t slot) noexcept
+    {
+        const auto lane = m_laneOfSlot[slot];
+        if (lane & PhasorLane)
+        {
+            const auto set = currentSet(slot);
+            computePowers(lane & ~PhasorLane, m_slotA1[set][slot], m_slotA2[set][slot]);
+        }
+        else
+        {
+            loadCoefficients(lane, slot);
+        }
+    }
+
+    void reloadActiveLanes() noexcept
+    {
+        forEachActiveSlot([this](const size_t slot) { reloadSlot(slot); });
+    }
+
+    // p^0 ... p^BlockSize for the pole of y[n] = -a1 y[n-1] - a2 y[n-2]
+    void computePowers(const size_t f, const float a1, const float a2) noexcept
+    {
+        const auto [pr, pi] = pole(a1, a2);
+        double re = 1.0;
+        double im = 0.0;
+        for (size_t i = 0; i <= BlockSize; ++i)
+        {
+            m_powRe[i][f] = static_cast<float>(re);
+            m_powIm[i][f] = static_cast<float>(im);
+            const auto nextRe = re * pr - im * pi;
+            im = re * pi + im * pr;
+            re = nextRe;
+        }
+    }
+
+    static std::pair<double, double> pole(const float a1, const float a2) noexcept
+    {
+        const auto r = std::sqrt(static_cast<double>(a2));
+        const auto c = std::clamp(-a1 / (2.0 * r), -1.0, 1.0);
+        return {r * c, r * std::sqrt(1.0 - c * c)};
+    }
+
+    // z with Re(z) = next output and Re(z / p) = y1, false if the pole is too close to the real axis
+    bool biquadToPhasor(const size_t k) noexcept
+    {
+        const auto [pr, pi] = pole(m_a1[k], m_a2[k]);
+        const auto r2 = pr * pr + pi * pi;
+        if (pi < 1E-4 * std::sqrt(r2))
+        {
+            return false;
+        }
+        const double y1 = m_y1[k];
+        const double next = -static_cast<double>(m_a1[k]) * y1 - static_cast<double>(m_a2[k]) * m_y2[k];
+        // Re((A + iB) * conj(p)) / |p|^2 = y1  =>  B = (y1 |p|^2 - A pr) / pi
+        const auto f = m_numFree++;
+        m_freeSlot[f] = m_slot[k];
+        m_zr[f] = static_cast<float>(next);
+        m_zi[f] = static_cast<float>((y1 * r2 - next * pr) / pi);
+        for (size_t c = 0; c < NumOutputs; ++c)
+        {
+            m_freePan[c][f] = m_pan[c][k];
+        }
+        computePowers(f, m_a1[k], m_a2[k]);
+        m_laneOfSlot[m_slot[k]] = static_cast<uint32_t>(f) | PhasorLane;
+        return true;
+    }
+
+    uint32_t phasorToBiquad(const size_t f) noexcept
+    {
+        const auto slot = m_freeSlot[f];
+        const std::complex<double> p{m_powRe[1][f], m_powIm[1][f]};
+        const auto z1 = std::complex<double>{m_zr[f], m_zi[f]} / p;
+        const auto z2 = z1 / p;
+
+        const auto lane = static_cast<uint32_t>(m_numActive++);
+        m_slot[lane] = slot;
+        m_x1[lane] = m_x2[lane] = 0.f;
+        m_y1[lane] = static_cast<float>(z1.real());
+        m_y2[lane] = static_cast<float>(z2.real());
+        for (size_t c = 0; c < NumOutputs; ++c)
+        {
+            m_pan[c][lane] = m_freePan[c][f];
+        }
+        loadCoefficients(lane, slot);
+        m_laneOfSlot[slot] = lane;
+        removeFreeLane(f);
+        return lane;
+    }
+
+    void removeFreeLane(const size_t f) noexcept
+    {
+        const auto last = --m_numFree;
+        if (f != last)
+        {
+            m_freeSlot[f] = m_freeSlot[last];
+            m_laneOfSlot[m_freeSlot[f]] = static_cast<uint32_t>(f) | PhasorLane;
+            m_zr[f] = m_zr[last];
+            m_zi[f] = m_zi[last];
+            for (size_t c = 0; c < NumOutputs; ++c)
+            {
+                m_freePan[c][f] = m_freePan[c][last];
+            }
+            for (size_t i = 0; i <= BlockSize; ++i)
+            {
+                m_powRe[i][f] = m_powRe[i][last];
+                m_powIm[i][f] = m_powIm[i][last];
+            }
+        }
+        m_zr[last] = m_zi[last] = 0.f;
+    }
+
+    void fillExcitation(const size_t g, float (&x)[BlockSize][Lanes],
+                        const ExcitationBursts<NumElements>& bursts) noexcept
+    {
+        const auto end = std::min(g + Lanes, m_numActive);
+        for (size_t l = g; l < end; ++l)
+        {
+            if (m_wait[l] > 0 && --m_wait[l] > 0)
+            {
+                continue;
+            }
+            if (m_position[l] <= 0.f)
+            {
+                continue;
+            }
+            const size_t start = m_startOffset[l];
+            m_startOffset[l] = 0;
+            bursts.render(m_slot[l], &x[start][l - g], Lanes, BlockSize - start, m_position[l], m_advance[l],
+                          m_gain[l], m_noiseCursor[m_slot[l]]);
+        }
+    }
+
+    // drops silent lanes, hands biquad lanes whose input has run out over to the phasor pool
+    void retireSilentLanes() noexcept
+    {
+        size_t k = 0;
+        while (k < m_numActive)
+        {
+            const bool exciting = m_wait[k] > 0 || m_position[k] > 0.f || m_x1[k] != 0.f || m_x2[k] != 0.f ||
+                                  m_overflow.pending(m_slot[k]);
+            const bool silent = std::abs(m_y1[k]) + std::abs(m_y2[k]) <= SilenceThreshold;
+            if (exciting || (!silent && !biquadToPhasor(k)))
+            {
+                ++k;
+                continue;
+            }
+            if (silent)
+            {
+                m_laneOfSlot[m_slot[k]] = NoLane;
+            }
+            removeBiquadLane(k);
+        }
+
+        size_t f = 0;
+        while (f < m_numFree)
+        {
+            if (std::abs(m_zr[f]) + std::abs(m_zi[f]) > SilenceThreshold)
+            {
+                ++f;
+                continue;
+            }
+            m_laneOfSlot[m_freeSlot[f]] = NoLane;
+            removeFreeLane(f);
+        }
+    }
+
+    // |w| of the state written as y1 = Re(w), y2 = Re(w / p), ignoring any input still to come
+    [[nodiscard]] float ringingAmplitude(const size_t k) const noexcept
+    {
+        const auto [pr, pi] = pole(m_a1[k], m_a2[k]);
+        const double y1 = m_y1[k];
+        if (pi <= 0.0)
+        {
+            return static_cast<float>(std::max(std::abs(y1), static_cast<double>(std::abs(m_y2[k]))));
+        }
+        const auto im = (static_cast<double>(m_y2[k]) * (pr * pr + pi * pi) - y1 * pr) / pi;
+        return static_cast<float>(std::hypot(y1, im));
+    }
+
+    void removeBiquadLane(const size_t k) noexcept
+    {
+        const auto last = --m_numActive;
+        if (k != last)
+        {
+            moveLane(last, k);
+        }
+        clearLane(last);
+    }
+
+    void moveLane(const size_t from, const size_t to) noexcept
+    {
+        m_slot[to] = m_slot[from];
+        m_laneOfSlot[m_slot[to]] = static_cast<uint32_t>(to);
+        m_b0[to] = m_b0[from];
+        m_a1[to] = m_a1[from];
+        m_a2[to] = m_a2[from];
+        m_x1[to] = m_x1[from];
+        m_x2[to] = m_x2[from];
+        m_y1[to] = m_y1[from];
+        m_y2[to] = m_y2[from];
+        m_position[to] = m_position[from];
+        m_advance[to] = m_advance[from];
+        m_gain[to] = m_gain[from];
+        m_wait[to] = m_wait[from];
+        m_startOffset[to] = m_startOffset[from];
+        for (size_t c = 0; c < NumOutputs; ++c)
+        {
+            m_pan[c][to] = m_pan[c][from];
+        }
+    }
+
+    // unused lanes of the last group run with zero coefficients and state, so they contribute silence
+    void clearLane(const size_t lane) noexcept
+    {
+        m_b0[lane] = m_a1[lane] = m_a2[lane] = 0.f;
+        m_x1[lane] = m_x2[lane] = m_y1[lane] = m_y2[lane] = 0.f;
+        m_position[lane] = 0.f;
+        m_gain[lane] = 0.f;
+        m_wait[lane] = 0;
+        m_startOffset[lane] = 0;
+    }
+
+    float m_sampleRate;
+    bool m_damped{false};
+    size_t m_numActive{0};
+    size_t m_numFree{0};
+
+    std::array<float, NumElements> m_cosOmega{};
+    std::array<std::array<float, NumElements>, 2> m_slotB0{};
+    std::array<std::array<float, NumElements>, 2> m_slotA1{};
+    std::array<std::array<float, NumElements>, 2> m_slotA2{};
+    std::array<uint32_t, NumElements> m_laneOfSlot{};
+    std::array<bool, NumElements> m_slotDamped{};
+    // per slot, so the noise a resonator reads does not depend on which other resonators are playing
+    std::array<uint32_t, NumElements> m_noiseCursor{};
+
+    alignas(64) std::array<float, MaxActive> m_b0{};
+    alignas(64) std::array<float, MaxActive> m_a1{};
+    alignas(64) std::array<float, MaxActive> m_a2{};
+    alignas(64) std::array<float, MaxActive> m_x1{};
+    alignas(64) std::array<float, MaxActive> m_x2{};
+    alignas(64) std::array<float, MaxActive> m_y1{};
+    alignas(64) std::array<float, MaxActive> m_y2{};
+    alignas(64) std::array<float, MaxActive> m_position{};
+    alignas(64) std::array<float, MaxActive> m_advance{};
+    alignas(64) std::array<float, MaxActive> m_gain{};
+    std::array<uint32_t, MaxActive> m_wait{};
+    std::array<uint32_t, MaxActive> m_startOffset{};
+    std::array<uint32_t, MaxActive> m_slot{};
+    alignas(64) LaneGains m_pan{};
+
+    alignas(64) std::array<float, MaxActive> m_zr{};
+    alignas(64) std::array<float, MaxActive> m_zi{};
+    alignas(64) std::array<std::array<float, MaxActive>, BlockSize + 1> m_powRe{};
+    alignas(64) std::array<std::array<float, MaxActive>, BlockSize + 1> m_powIm{};
+    std::array<uint32_t, MaxActive> m_freeSlot{};
+    alignas(64) LaneGains m_freePan{};
+    ExcitationOverflow<NumElements, OverflowCursors> m_overflow;
+};
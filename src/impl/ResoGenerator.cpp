@@ -1,10 +1,5 @@
-#include "ResoGenerator.h"
+#include "PingSynth.h"
 
-static constexpr int minMidiNote{21};
-static constexpr int maxMidiNote{132};
-static constexpr int range{maxMidiNote - minMidiNote};
-static constexpr int stepsPerSemitone{66};
-
-static constexpr size_t NumElements{range * (stepsPerSemitone) + 1};
-
-template class ResoGenerator<16, NumElements>;
+// the engines of PingSynth, mono and the stereo one of the plugin, on the slot grid PingSynth uses
+template class ResoGenerator<16, PingSynth<16>::NumElements>;
+template class ResoGenerator<16, PingSynth<16, 2>::NumElements, 2>;
@@ -1,32 +1,76 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
-#include <iostream>
+#include <cstdint>
 #include <memory>
+#include <numbers>
 #include <random>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "Filters/BiquadResoBP.h"
+#include "ExcitationBursts.h"
+#include "ExcitationOverflow.h"
+#include "HalfBandInterpolator.h"
 #include "PingExcitation.h"
+#include "ResoBank.h"
+#include "ResoWorkerPool.h"
+#include "TraceLog.h"
+#include "TriggerQueue.h"
 
-template <size_t BlockSize, size_t NumElements>
+#ifndef PINGSYNTH_RESO_BANK
+#define PINGSYNTH_RESO_BANK 0
+#endif
+
+// what a trigger does to a slot whose excitation is still running
+enum class CollisionPolicy
+{
+    Replace, // restart the excitation with the new gain
+    Sum,     // keep the running excitation and add the new gain to it
+    Max,     // keep the running excitation, at the larger of both gains
+    Queue,   // run both excitations through the resonator, from a bounded overflow pool (Sum when it is full)
+};
+
+/*
+ * NumOutputs > 1 places every resonator with a constant power pan across the outputs, see panGains(); the
+ * resonator is still computed once and only its accumulation is done per output.
+ */
+template <size_t BlockSize, size_t NumElements, size_t NumOutputs = 1, bool BankEngine = (PINGSYNTH_RESO_BANK != 0)>
 class ResoGenerator
 {
   public:
+    using OutputBlock = std::array<std::array<float, BlockSize>, NumOutputs>;
+    using ChannelGains = std::array<float, NumOutputs>;
+
+    // the vectorized structure-of-arrays bank instead of the BiquadResoBP array, PINGSYNTH_RESO_BANK by default;
+    // only the selected engine has storage
+    static constexpr bool UseResoBank{BankEngine};
+    // full rate plus as many octave decimated rates as divide the block evenly, at most 1/8
+    static constexpr size_t NumRates{BlockSize % 8 == 0 ? 4 : BlockSize % 4 == 0 ? 3 : BlockSize % 2 == 0 ? 2 : 1};
+
     explicit ResoGenerator(const float sampleRate, const int minMidiNote, const int stepsPerSemitone)
         : m_sampleRate(sampleRate)
         , m_excitation(1024)
+        , m_bursts(m_excitation)
+        , m_bank(sampleRate)
     {
-        fillFrequencyTable(minMidiNote, stepsPerSemitone);
-        calculatePhaseAdvances();
-
-        for (auto& f : m_bq)
+        PINGSYNTH_TRACE_START();
+        m_slotOwner.fill(NoOwner);
+        for (size_t j = 0; j < NumElements; ++j)
         {
-            f.setSampleRate(sampleRate);
+            m_noiseCursor[j] = Excitation::noiseStart(j);
         }
-
-        assignFrequencyAndDecay();
+        fillFrequencyTable(minMidiNote, stepsPerSemitone);
     }
 
+    // neither copyable nor movable, m_bursts and the render workers point into the generator
+    ResoGenerator(const ResoGenerator&) = delete;
+    ResoGenerator& operator=(const ResoGenerator&) = delete;
+
     void setDecay(const float decay) noexcept
     {
         m_decay = decay;
@@ -39,34 +83,233 @@ class ResoGenerator
         newDecay();
     }
 
+    // lazy: a decay change recomputes the ringing resonators at once, idle slots on their next trigger or
+    // spread over the following blocks; otherwise all slots are rewritten immediately
+    void setLazyDecayUpdate(const bool lazy) noexcept
+    {
+        m_lazyDecay = lazy;
+    }
+
     void setExcitationNoise(const float value) noexcept
     {
         m_excitation.setNoise(value);
+        updateBurstAdvances();
     }
 
-    void triggerNew(size_t index, float power, size_t triggerWaitBlocks)
+    // regenerates the excitation noise table, not real-time safe
+    void setNoiseSeed(const uint64_t seed)
     {
-        std::cout << index << "\t" << m_frequencies[index] << "\t" << power << std::endl;
+        m_excitation.regenerateNoise(seed);
+    }
 
-        m_trigger[index] = static_cast<float>(m_excitation.getPatternLength() - 1);
-        m_triggerGain[index] = power * logisticCompensation(m_frequencies[index]);
-        m_triggerWait[index] = triggerWaitBlocks;
-        m_activeState[index] = triggerWaitBlocks == 0 ? 1 : 2;
-        cntActive++;
+    // applies to the following triggers, running excitations switch shape mid burst; the burst cache only serves
+    // the shape it was built for, the slots keep their exact excitation until prepareExcitationCache() rebuilds it
+    void setExcitationShape(const ExcitationShape shape) noexcept
+    {
+        m_excitation.setShape(shape);
+        updateBurstAdvances();
+    }
+
+    // the sample for ExcitationShape::Sample, see Excitation::setSample(); not real-time safe
+    bool loadExcitationSample(const std::span<const float> samples)
+    {
+        if (!m_excitation.setSample(samples))
+        {
+            return false;
+        }
+        prepareExcitationCache();
+        return true;
+    }
+
+    /*
+     * Caches the noise free excitation bursts in an arena of maxBytes, 0 turns it off. The slots of a band with a
+     * burst are then excited with the burst of the band centre, a detuning of at most BandSlots / 2 slots in the
+     * excitation only; the resonator frequencies are unchanged. The bursts of all bands are rendered here, once
+     * the arena is full the remaining bands keep their exact excitation, as does every slot while the shape or
+     * the noise does not match the bursts. Allocates, call it outside the audio callback.
+     */
+    void setExcitationCache(const size_t maxBytes)
+    {
+        m_bursts.setCapacity(maxBytes);
+        calculatePhaseAdvances();
+    }
+
+    /*
+     * Renders the cached bursts again for the current shape, after setExcitationShape() or a change of the
+     * excitation noise back to 0. Bands without a burst render from the pattern, so this is never needed for
+     * correctness. Takes a while, call it outside the audio callback.
+     */
+    void prepareExcitationCache()
+    {
+        m_bursts.prepareAll(m_exactAdvance);
+        assignPhaseAdvances();
+    }
+
+    // resonators whose amplitude falls below this level are stopped instead of ringing down to silence
+    void setAudibilityFloor(const float dBFS) noexcept
+    {
+        m_audibleLevel = std::pow(10.f, dBFS / 20.f);
+    }
+
+    // hard cap on simultaneously running resonators, the least audible ones are stolen above it
+    void setMaxActiveResonators(const size_t count) noexcept
+    {
+        m_maxActive = std::clamp<size_t>(count, 1, NumElements);
+    }
+
+    [[nodiscard]] size_t activeResonators() const noexcept
+    {
+        return cntActive;
+    }
+
+    /*
+     * Renders the resonators far enough below Nyquist at 1/2, 1/4 or 1/8 of the sample rate; the decimated
+     * sums are brought back up through a cascade of half-band interpolators, so the low bands lag by the
+     * interpolator group delay (35 samples for the 1/8 band). Retunes all slots and stops the running
+     * resonators, call it outside the audio callback. Ignored with the ResoBank engine.
+     */
+    void setMultirate(const bool enable)
+    {
+        if constexpr (!UseResoBank)
+        {
+            m_numRates = enable ? NumRates : 1;
+            for (size_t k = 0; k < cntActive; ++k)
+            {
+                releaseResonator(m_activeList[k]);
+            }
+            cntActive = 0;
+            m_bq.fill(AbacDsp::BiquadResoBP{});
+            for (auto& rate : m_interpolators)
+            {
+                for (auto& interpolator : rate)
+                {
+                    interpolator.reset();
+                }
+            }
+            assignSlotRates();
+            calculatePhaseAdvances();
+            assignFrequencyAndDecay();
+            newDecay();
+            setDampMode(m_dampMode);
+        }
+    }
+
+    /*
+     * Splits the BiquadResoBP render across numThreads bands, the calling thread renders the first. A band is an
+     * equal share of the active list, which is kept in trigger order and not sorted by slot, so a band is not a
+     * contiguous frequency range: equal shares keep the workers evenly loaded however the notes cluster. The
+     * count is clamped to the hardware concurrency, spinning workers that share a core only take time from each
+     * other; pinToCores pins worker k to core k, see ResoWorkerPool. Partial sums are added in band order, so for
+     * a given count the output does not depend on thread timing. Allocates and starts threads, call it outside
+     * the audio callback. Ignored with the ResoBank engine.
+     */
+    void setRenderThreads(const size_t numThreads, const bool pinToCores = false)
+    {
+        m_workers.reset();
+        if constexpr (!UseResoBank)
+        {
+            const auto count = std::min(numThreads, std::max<size_t>(std::thread::hardware_concurrency(), 1));
+            if (count <= 1)
+            {
+                return;
+            }
+            m_partials.assign(count, {});
+            m_workers = std::make_unique<ResoWorkerPool>(
+                count - 1,
+                [this, count](const size_t band)
+                {
+                    auto& partial = m_partials[band];
+                    clearRates(partial);
+                    renderBand(partial, band * cntActive / count, (band + 1) * cntActive / count);
+                },
+                pinToCores);
+        }
+    }
+
+    // threads rendering the resonators, the calling thread included
+    [[nodiscard]] size_t renderThreads() const noexcept
+    {
+        return m_workers ? m_workers->numPartitions() : 1;
+    }
+
+    static constexpr uint8_t NoOwner{0xFF};
+
+    void setCollisionPolicy(const CollisionPolicy policy) noexcept
+    {
+        m_collisionPolicy = policy;
+    }
+
+    // queues a trigger, it is applied at the start of the next processBlock(), sampleOffset delays the
+    // excitation start within that block, pan places the resonator from the first (0) to the last output (1),
+    // owner (e.g. the MIDI note) takes over the slot for dampOwner(); an index past the last slot is dropped and
+    // counted like a trigger that found the queue full
+    bool triggerNew(size_t index, float power, size_t triggerWaitBlocks, size_t sampleOffset = 0, float pan = 0.5f,
+                    uint8_t owner = NoOwner) noexcept
+    {
+        if (index >= NumElements)
+        {
+            m_triggerQueue.reject();
+            return false;
+        }
+        PINGSYNTH_TRACE(TraceKind::ResonatorTrigger, index, m_frequencies[index], power);
+
+        return m_triggerQueue.push({static_cast<uint32_t>(index), power, static_cast<uint32_t>(triggerWaitBlocks),
+                                    static_cast<uint32_t>(sampleOffset), pan, owner, TriggerKind::Start});
+    }
+
+    // switches the running resonators still owned by owner to their damped coefficients; queued behind the
+    // pending triggers, so a note-off never overtakes its own note-on
+    bool dampOwner(const uint8_t owner) noexcept
+    {
+        return m_triggerQueue.push({0, 0.f, 0, 0, 0.5f, owner, TriggerKind::DampOwner});
+    }
+
+    /*
+     * Constant power pan over outputs laid out on a line, a position between two neighbouring outputs feeds
+     * just those two. Scaled so that halfway between two outputs both get unity gain, a centred stereo
+     * source therefore keeps the level of a plain mono copy.
+     */
+    static ChannelGains panGains(const float position) noexcept
+    {
+        ChannelGains gains{};
+        if constexpr (NumOutputs == 1)
+        {
+            gains[0] = 1.f;
+        }
+        else
+        {
+            const auto x = std::clamp(position, 0.f, 1.f) * static_cast<float>(NumOutputs - 1);
+            const auto k = std::min(static_cast<size_t>(x), NumOutputs - 2);
+            const auto angle = (x - static_cast<float>(k)) * std::numbers::pi_v<float> * 0.5f;
+            gains[k] = std::numbers::sqrt2_v<float> * std::cos(angle);
+            gains[k + 1] = std::numbers::sqrt2_v<float> * std::sin(angle);
+        }
+        return gains;
     }
 
+    // triggers lost to a full queue or to an invalid slot
+    [[nodiscard]] size_t droppedTriggers() const noexcept
+    {
+        return m_triggerQueue.droppedCount();
+    }
+
+    // drops decayed resonators whose excitation is over from the active list, swapping the last entry into the
+    // freed position; the ResoBank engine keeps its own list
     void checkActivity()
     {
-        cntActive = 0;
-        for (size_t j = 0; j < m_bq.size(); ++j)
+        if constexpr (!UseResoBank)
         {
-            if (m_activeState[j])
+            size_t k = 0;
+            while (k < cntActive)
             {
-                cntActive++;
-                if (m_activeState[j] == 1)
+                const auto j = m_activeList[k];
+                if (m_activeState[j] == 1 && m_trigger[j] <= 0.f && !m_bq[j].isActive() && !m_overflow.pending(j))
                 {
-                    m_activeState[j] = m_bq[j].isActive() ? 1 : 0;
+                    m_activeState[j] = 0;
+                    m_activeList[k] = m_activeList[--cntActive];
+                    continue;
                 }
+                ++k;
             }
         }
     }
@@ -80,135 +323,669 @@ class ResoGenerator
     }
 
     void processBlock(std::array<float, BlockSize>& out) noexcept
+        requires(NumOutputs == 1)
+    {
+        OutputBlock block;
+        processBlock(block);
+        out = block[0];
+    }
+
+    void processBlock(OutputBlock& out) noexcept
+    {
+        for (auto& channel : out)
+        {
+            channel.fill(0.f);
+        }
+        refreshStaleSlots();
+        m_triggerQueue.drain(
+            [this](const TriggerEvent& event)
+            {
+                if (event.kind == TriggerKind::DampOwner)
+                {
+                    dampSlotsOf(event.owner);
+                }
+                else
+                {
+                    startResonator(event);
+                }
+            });
+        applyVoiceBudget();
+
+        if constexpr (UseResoBank)
+        {
+            m_bank.processBlock(out, m_bursts);
+            cntActive = m_bank.activeCount();
+        }
+        else
+        {
+            renderResonators(out);
+        }
+    }
+
+    void fillFrequencyTable(const int minMidiNote, const int stepsPerSemitone)
+    {
+        const auto baseFrequency = 440 * std::pow(2.f, static_cast<float>(minMidiNote - 69) / 12.f);
+        const auto slotsPerOctave = static_cast<float>(stepsPerSemitone) * 12;
+
+        for (size_t j = 0; j < NumElements; ++j)
+        {
+            const auto f = baseFrequency * std::pow(2.f, static_cast<float>(j) / slotsPerOctave);
+            m_frequencies[j] = f;
+        }
+        fillSlotTables();
+        assignSlotRates();
+        calculatePhaseAdvances();
+        assignFrequencyAndDecay();
+    }
+
+    const std::array<float, NumElements> getFrequencies() const
+    {
+        return m_frequencies;
+    }
+
+    void setDampMode(const bool mode)
+    {
+        m_dampMode = mode;
+        if constexpr (UseResoBank)
+        {
+            m_bank.damp(mode);
+        }
+        else
+        {
+            for (size_t j = 0; j < NumElements; ++j)
+            {
+                m_bq[j].damp(mode || m_slotDamped[j]);
+            }
+        }
+    }
+
+  private:
+    template <typename Func>
+    void forEachActiveSlot(Func&& func)
+    {
+        if constexpr (UseResoBank)
+        {
+            m_bank.forEachActiveSlot(func);
+        }
+        else
+        {
+            for (size_t k = 0; k < cntActive; ++k)
+            {
+                func(static_cast<size_t>(m_activeList[k]));
+            }
+        }
+    }
+
+    void dampSlotsOf(const uint8_t owner) noexcept
+    {
+        forEachActiveSlot(
+            [this, owner](const size_t j)
+            {
+                if (m_slotOwner[j] == owner)
+                {
+                    m_slotOwner[j] = NoOwner;
+                    m_slotDamped[j] = true;
+                    applySlotDamp(j);
+                }
+            });
+    }
+
+    void applySlotDamp(const size_t j) noexcept
+    {
+        if constexpr (UseResoBank)
+        {
+            m_bank.dampSlot(j, m_slotDamped[j]);
+        }
+        else
+        {
+            m_bq[j].damp(m_dampMode || m_slotDamped[j]);
+        }
+    }
+
+    /*
+     * Culls resonators below the audibility floor, then steals the least audible ones until at most
+     * m_maxActive remain. Works on the levels of the previous block; a freshly triggered resonator counts
+     * with its excitation gain. Runs before rendering, so the cap bounds the work of every block.
+     */
+    void applyVoiceBudget() noexcept
+    {
+        if constexpr (UseResoBank)
+        {
+            cntActive = m_bank.activeCount();
+        }
+        if (cntActive == 0 || (m_audibleLevel <= 0.f && cntActive <= m_maxActive))
+        {
+            return;
+        }
+        size_t count = 0;
+        forEachActiveLevel([this, &count](const size_t j, const float level)
+                           { m_levelOrder[count++] = {level, static_cast<uint32_t>(j)}; });
+
+        const auto begin = m_levelOrder.begin();
+        auto end = begin + static_cast<std::ptrdiff_t>(count);
+        const auto audible = std::partition(begin, end, [this](const auto& e) { return e.first >= m_audibleLevel; });
+        std::for_each(audible, end, [this](const auto& e) { releaseResonator(e.second); });
+        end = audible;
+
+        const auto remaining = static_cast<size_t>(end - begin);
+        if (remaining > m_maxActive)
+        {
+            const auto stolen = begin + static_cast<std::ptrdiff_t>(remaining - m_maxActive);
+            std::nth_element(begin, stolen, end);
+            std::for_each(begin, stolen, [this](const auto& e) { releaseResonator(e.second); });
+        }
+
+        if constexpr (UseResoBank)
+        {
+            cntActive = m_bank.activeCount();
+        }
+        else
+        {
+            const auto last = std::remove_if(m_activeList.begin(), m_activeList.begin() + cntActive,
+                                             [this](const uint32_t j) { return m_activeState[j] == 0; });
+            cntActive = static_cast<size_t>(last - m_activeList.begin());
+        }
+    }
+
+    template <typename Func>
+    void forEachActiveLevel(Func&& func) const
+    {
+        if constexpr (UseResoBank)
+        {
+            m_bank.forEachActiveLevel(func);
+        }
+        else
+        {
+            for (size_t k = 0; k < cntActive; ++k)
+            {
+                const auto j = m_activeList[k];
+                const auto pending = m_activeState[j] == 2 || m_trigger[j] > 0.f ? m_triggerGain[j] : 0.f;
+                func(static_cast<size_t>(j), std::max(m_level[j], pending));
+            }
+        }
+    }
+
+    // the BiquadResoBP keeps its state, a retrigger continues from the (inaudible) level it was stopped at
+    void releaseResonator(const size_t j) noexcept
+    {
+        if constexpr (UseResoBank)
+        {
+            m_bank.release(j);
+        }
+        else
+        {
+            m_activeState[j] = 0;
+            m_trigger[j] = 0.f;
+            m_triggerGain[j] = 0.f;
+            m_level[j] = 0.f;
+            m_overflow.dropSlot(j);
+        }
+    }
+
+    // per block factor of a peak hold that falls at the -60 dB decay rate of the resonator
+    [[nodiscard]] float levelRelease(const float decay) const noexcept
+    {
+        return std::exp(-6.9077553f * static_cast<float>(BlockSize) / (decay * m_sampleRate));
+    }
+
+    using RateBuffers = std::array<OutputBlock, NumRates>;
+
+    void clearRates(RateBuffers& rates) const noexcept
+    {
+        for (size_t s = 0; s < m_numRates; ++s)
+        {
+            for (auto& channel : rates[s])
+            {
+                std::fill_n(channel.begin(), BlockSize >> s, 0.f);
+            }
+        }
+    }
+
+    // a slot runs at 1/2^s of the sample rate while it stays within the interpolator passband (0.2 of that rate)
+    void assignSlotRates() noexcept
+    {
+        for (size_t j = 0; j < NumElements; ++j)
+        {
+            uint8_t shift = 0;
+            while (shift + 1u < m_numRates && m_frequencies[j] < 0.2f * slotRate(shift + 1u))
+            {
+                ++shift;
+            }
+            m_slotShift[j] = shift;
+        }
+    }
+
+    [[nodiscard]] float slotRate(const size_t shift) const noexcept
+    {
+        return m_sampleRate / static_cast<float>(1u << shift);
+    }
+
+    // folds the decimated sums into the next higher rate, lowest rate first, and adds the result to out
+    void interpolateRates(OutputBlock& out) noexcept
+    {
+        for (size_t c = 0; c < NumOutputs; ++c)
+        {
+            for (size_t s = m_numRates - 1; s > 0; --s)
+            {
+                std::array<float, BlockSize> upsampled;
+                m_interpolators[s - 1][c].process(m_rateOut[s][c].data(), upsampled.data(), BlockSize >> s);
+                for (size_t i = 0; i < BlockSize >> (s - 1); ++i)
+                {
+                    m_rateOut[s - 1][c][i] += upsampled[i];
+                }
+            }
+            for (size_t i = 0; i < BlockSize; ++i)
+            {
+                out[c][i] += m_rateOut[0][c][i];
+            }
+        }
+    }
+
+    void accumulate(OutputBlock& out, const size_t j, const size_t i, const float y) const noexcept
+    {
+        if constexpr (NumOutputs == 1)
+        {
+            out[0][i] += y;
+        }
+        else
+        {
+            for (size_t c = 0; c < NumOutputs; ++c)
+            {
+                out[c][i] += m_channelGains[j][c] * y;
+            }
+        }
+    }
+
+    // per slot constants, so neither triggers nor decay changes need pow/log2 per slot
+    void fillSlotTables() noexcept
+    {
+        const float middleC = 440.f * std::pow(2.f, -9.f / 12.f); // ~261.63 Hz
+        for (size_t j = 0; j < NumElements; ++j)
+        {
+            m_compensation[j] = logisticCompensation(m_frequencies[j]);
+            m_octavesFromMiddleC[j] = std::log2(m_frequencies[j] / middleC);
+        }
+    }
+
+    void startResonator(const TriggerEvent& event) noexcept
+    {
+        const size_t index = event.index;
+        const auto power = event.gain;
+        const size_t triggerWaitBlocks = event.waitBlocks;
+        const size_t startOffset = std::min<size_t>(event.sampleOffset, BlockSize - 1);
+        if (m_slotGeneration[index] != m_decayGeneration)
+        {
+            applySlotDecay(index);
+        }
+        m_slotOwner[index] = event.owner;
+        if (m_slotDamped[index])
+        {
+            m_slotDamped[index] = false;
+            applySlotDamp(index);
+        }
+
+        const auto position = static_cast<float>(m_excitation.getPatternLength() - 1);
+        auto gain = power * m_compensation[index];
+        if (m_collisionPolicy != CollisionPolicy::Replace && excitationRunning(index))
+        {
+            switch (m_collisionPolicy)
+            {
+                case CollisionPolicy::Queue:
+                    if (addOverlay(index, position, gain, triggerWaitBlocks, startOffset))
+                    {
+                        return;
+                    }
+                    [[fallthrough]]; // pool exhausted
+                case CollisionPolicy::Sum:
+                    if (setRunningGain(index, runningGain(index) + gain))
+                    {
+                        return;
+                    }
+                    break; // only overlays are running, start a new excitation next to them
+                case CollisionPolicy::Max:
+                    if (gain <= runningGain(index) || setRunningGain(index, gain))
+                    {
+                        return;
+                    }
+                    break;
+                case CollisionPolicy::Replace:
+                    break;
+            }
+        }
+
+        if constexpr (UseResoBank)
+        {
+            m_bank.trigger(index, position, m_phaseAdvance[index], gain, triggerWaitBlocks, startOffset,
+                           panGains(event.pan));
+            return;
+        }
+        m_channelGains[index] = panGains(event.pan);
+        m_trigger[index] = position;
+        m_triggerGain[index] = gain;
+        m_triggerWait[index] = triggerWaitBlocks;
+        m_triggerOffset[index] = startOffset;
+        if (m_activeState[index] == 0)
+        {
+            m_activeList[cntActive++] = static_cast<uint32_t>(index);
+        }
+        m_activeState[index] = triggerWaitBlocks == 0 ? 1 : 2;
+    }
+
+    [[nodiscard]] bool excitationRunning(const size_t j) const noexcept
+    {
+        if constexpr (UseResoBank)
+        {
+            return m_bank.exciting(j);
+        }
+        return m_activeState[j] == 2 || m_trigger[j] > 0.f || m_overflow.pending(j);
+    }
+
+    [[nodiscard]] float runningGain(const size_t j) const noexcept
+    {
+        if constexpr (UseResoBank)
+        {
+            return m_bank.excitationGain(j);
+        }
+        return m_triggerGain[j];
+    }
+
+    // raises the gain of the running excitation of j without moving its cursor, false when there is none
+    bool setRunningGain(const size_t j, const float gain) noexcept
+    {
+        if constexpr (UseResoBank)
+        {
+            return m_bank.setExcitationGain(j, gain);
+        }
+        if (m_trigger[j] <= 0.f)
+        {
+            return false;
+        }
+        m_triggerGain[j] = gain;
+        return true;
+    }
+
+    bool addOverlay(const size_t j, const float position, const float gain, const size_t waitBlocks,
+                    const size_t startOffset) noexcept
     {
-        for (size_t i = 0; i < BlockSize; ++i)
+        if constexpr (UseResoBank)
         {
-            out[i] = 0.f;
+            return m_bank.overlay(j, position, m_phaseAdvance[j], gain, waitBlocks, startOffset);
         }
+        return m_overflow.add(j, position, m_phaseAdvance[j], gain, waitBlocks, startOffset >> m_slotShift[j],
+                              m_noiseCursor[j] + Excitation::NoiseSize / 2);
+    }
 
-        if (!cntActive)
+    // the BiquadResoBP engine, on the worker bands when there are any
+    void renderResonators(OutputBlock& out) noexcept
+    {
+        if (!cntActive && m_numRates == 1)
         {
             return;
         }
 
-        for (size_t j = 0; j < m_bq.size(); ++j)
+        clearRates(m_rateOut);
+        m_overflow.beginBlock();
+        if (m_workers)
         {
-            if (m_activeState[j] == 2)
+            m_workers->run();
+            for (const auto& partial : m_partials)
             {
-                --m_triggerWait[j];
-                if (m_triggerWait[j] == 0)
+                for (size_t s = 0; s < m_numRates; ++s)
                 {
-                    m_activeState[j] = 1;
+                    for (size_t c = 0; c < NumOutputs; ++c)
+                    {
+                        for (size_t i = 0; i < BlockSize >> s; ++i)
+                        {
+                            m_rateOut[s][c][i] += partial[s][c][i];
+                        }
+                    }
                 }
             }
-            if (m_activeState[j] == 1)
+        }
+        else
+        {
+            renderBand(m_rateOut, 0, cntActive);
+        }
+        interpolateRates(out);
+        m_overflow.endBlock();
+        checkActivity();
+    }
+
+    // renders the resonators at positions [listBegin, listEnd) of the active list, each one writes
+    // BlockSize >> shift samples to the buffer of its rate
+    void renderBand(RateBuffers& rateOut, const size_t listBegin, const size_t listEnd) noexcept
+    {
+        if constexpr (!UseResoBank)
+        {
+            for (size_t k = listBegin; k < listEnd; ++k)
             {
-                for (size_t i = 0; i < BlockSize; ++i)
+                const auto j = m_activeList[k];
+                if (m_activeState[j] == 2)
                 {
+                    --m_triggerWait[j];
+                    if (m_triggerWait[j] == 0)
+                    {
+                        m_activeState[j] = 1;
+                    }
+                }
+                if (m_activeState[j] == 1)
+                {
+                    auto& out = rateOut[m_slotShift[j]];
+                    const auto numSamples = BlockSize >> m_slotShift[j];
+                    const auto startOffset = m_triggerOffset[j] >> m_slotShift[j];
+                    m_triggerOffset[j] = 0;
+                    float input[BlockSize];
+                    std::fill_n(input, numSamples, 0.f);
+                    // excitations that collided with a running one, summed into the same resonator
+                    if (m_overflow.pending(j))
+                    {
+                        m_overflow.render(j, input, numSamples, 1, m_bursts);
+                    }
                     if (m_trigger[j] > 0.0f)
                     {
-                        const auto excitationValue = m_excitation.getInterpolatedValue(m_trigger[j]);
-                        const auto v = m_triggerGain[j] * excitationValue;
-                        out[i] += m_bq[j].step(v);
-                        m_trigger[j] -= m_phaseAdvance[j];
+                        m_bursts.render(j, input + startOffset, 1, numSamples - startOffset, m_trigger[j],
+                                        m_phaseAdvance[j], m_triggerGain[j], m_noiseCursor[j]);
                         if (m_trigger[j] <= 0.0f)
                         {
                             m_triggerGain[j] = 0.f;
                         }
                     }
-                    else
+                    float peak = 0.f;
+                    for (size_t i = 0; i < numSamples; ++i)
                     {
-                        out[i] += m_bq[j].step(0.f);
+                        const auto y = m_bq[j].step(input[i]);
+                        accumulate(out, j, i, y);
+                        peak = std::max(peak, std::abs(y));
                     }
+                    m_level[j] = std::max(peak, m_level[j] * m_levelRelease[j]);
                 }
             }
         }
-        checkActivity();
     }
 
-    void fillFrequencyTable(const int minMidiNote, const int stepsPerSemitone) noexcept
+    // the advance that makes the excitation of slot j last two periods of frequency, at the rate of slot j
+    [[nodiscard]] float phaseAdvance(const float frequency, const size_t j) const noexcept
     {
-        const auto baseFrequency = 440 * std::pow(2.f, static_cast<float>(minMidiNote - 69) / 12.f);
-        const auto slotsPerOctave = static_cast<float>(stepsPerSemitone) * 12;
+        const float patternLength = static_cast<float>(m_excitation.getPatternLength());
+        constexpr float periodsInPattern = 2.0f;
+        const float samplesForTwoPeriods = (periodsInPattern / frequency) * slotRate(m_slotShift[j]);
+        return patternLength / samplesForTwoPeriods;
+    }
 
-        for (size_t j = 0; j < m_bq.size(); ++j)
+    void calculatePhaseAdvances()
+    {
+        for (size_t j = 0; j < NumElements; ++j)
         {
-            const auto f = baseFrequency * std::pow(2.f, static_cast<float>(j) / slotsPerOctave);
-            m_frequencies[j] = f;
+            m_exactAdvance[j] = phaseAdvance(m_frequencies[j], j);
         }
-        calculatePhaseAdvances();
-        assignFrequencyAndDecay();
+        prepareExcitationCache();
     }
 
-    const std::array<float, NumElements> getFrequencies() const
+    // a slot whose band has a burst for the current excitation shares the advance of the band centre, so it
+    // plays that burst; every other slot keeps its exact advance
+    void assignPhaseAdvances() noexcept
     {
-        return m_frequencies;
+        m_burstsMatch = m_bursts.matchesExcitation();
+        for (size_t j = 0; j < NumElements; ++j)
+        {
+            const auto banded = phaseAdvance(m_frequencies[ExcitationBursts<NumElements>::bandSlot(j)], j);
+            m_phaseAdvance[j] = m_bursts.serves(j, banded) ? banded : m_exactAdvance[j];
+        }
     }
 
-    void setDampMode(const bool mode)
+    // the shape or the noise changed: moves the slots to or from the band advances when the bursts stopped or
+    // started matching the excitation, in one pass over the slots
+    void updateBurstAdvances() noexcept
     {
-        for (auto& b : m_bq)
+        if (m_bursts.enabled() && m_bursts.matchesExcitation() != m_burstsMatch)
         {
-            b.damp(mode);
+            assignPhaseAdvances();
         }
     }
 
-  private:
-    void calculatePhaseAdvances() noexcept
+    void assignFrequencyAndDecay() noexcept
     {
-        const float patternLength = static_cast<float>(m_excitation.getPatternLength());
-        constexpr float periodsInPattern = 2.0f;
-
-        for (size_t j = 0; j < m_frequencies.size(); ++j)
+        for (size_t j = 0; j < NumElements; ++j)
         {
-            const float samplesForTwoPeriods = (periodsInPattern / m_frequencies[j]) * m_sampleRate;
-            m_phaseAdvance[j] = patternLength / samplesForTwoPeriods;
+            if constexpr (UseResoBank)
+            {
+                m_bank.setByDecay(0, j, m_frequencies[j], 0.01f + m_decay * 10.f);
+                m_bank.setByDecay(1, j, m_frequencies[j], 0.1f);
+            }
+            else
+            {
+                m_bq[j].setSampleRate(slotRate(m_slotShift[j]));
+                m_bq[j].setByDecay(0, m_frequencies[j], 0.01f + m_decay * 10.f);
+                m_bq[j].setByDecay(1, m_frequencies[j], 0.1f);
+            }
         }
+        m_levelRelease.fill(levelRelease(0.01f + m_decay * 10.f));
     }
 
+    float m_decaySkew = 0.3f;
 
-    void assignFrequencyAndDecay() noexcept
+    void newDecay() noexcept
     {
-        for (size_t j = 0; j < m_bq.size(); ++j)
+        m_centerDecay = 0.02f + m_decay * 30.f;
+        ++m_decayGeneration;
+
+        if (m_lazyDecay)
+        {
+            forEachActiveSlot([this](const size_t j) { applySlotDecay(j); });
+            m_refreshCursor = 0;
+            return;
+        }
+
+        for (size_t j = 0; j < NumElements; ++j)
+        {
+            m_slotDecay[j] = slotDecay(j);
+        }
+        m_slotGeneration.fill(m_decayGeneration);
+        m_refreshCursor = NumElements;
+        if constexpr (UseResoBank)
         {
-            m_bq[j].setByDecay(0, m_frequencies[j], 0.01f + m_decay * 10.f);
-            m_bq[j].setByDecay(1, m_frequencies[j], 0.1f);
+            m_bank.setDecays(0, m_slotDecay);
+        }
+        else
+        {
+            for (size_t j = 0; j < NumElements; ++j)
+            {
+                m_bq[j].setDecay(0, m_slotDecay[j]);
+                m_levelRelease[j] = levelRelease(m_slotDecay[j]);
+            }
         }
     }
 
-    float m_decaySkew = 0.3f;
+    [[nodiscard]] float slotDecay(const size_t j) const noexcept
+    {
+        return m_centerDecay * std::exp2(-m_decaySkew * m_octavesFromMiddleC[j]);
+    }
 
-    void newDecay() noexcept
+    void applySlotDecay(const size_t j) noexcept
     {
-        const float centerDecay = 0.02f + m_decay * 30.f;
-        // Middle C as reference
-        const float centerFreq = 440.f * std::pow(2.f, -9.f / 12.f); // ~261.63 Hz (middle C)
+        m_slotGeneration[j] = m_decayGeneration;
+        if constexpr (UseResoBank)
+        {
+            m_bank.setDecay(0, j, slotDecay(j));
+        }
+        else
+        {
+            const auto decay = slotDecay(j);
+            m_bq[j].setDecay(0, decay);
+            m_levelRelease[j] = levelRelease(decay);
+        }
+    }
 
-        for (size_t j = 0; j < m_bq.size(); ++j)
+    // sweeps the idle slots that still carry an old decay generation, a fixed chunk per block
+    void refreshStaleSlots() noexcept
+    {
+        const auto end = std::min(m_refreshCursor + DecayRefreshChunk, NumElements);
+        for (; m_refreshCursor < end; ++m_refreshCursor)
         {
-            float adjDecay = centerDecay;
-            if (m_decaySkew != 0.0f)
+            if (m_slotGeneration[m_refreshCursor] != m_decayGeneration)
             {
-                const float octaveDistanceFromCenter = std::log2(m_frequencies[j] / centerFreq);
-                const float skewMultiplier = std::pow(2.0f, -m_decaySkew * octaveDistanceFromCenter);
-                adjDecay = centerDecay * skewMultiplier;
+                applySlotDecay(m_refreshCursor);
             }
-            m_bq[j].setDecay(0, adjDecay);
         }
     }
 
+    // stands in for the engine that is not selected
+    struct NoEngine
+    {
+        NoEngine() = default;
+        explicit NoEngine(float) noexcept
+        {
+        }
+    };
+
+    static constexpr size_t DecayRefreshChunk{256};
+    static constexpr size_t OverflowCursors{128};
+
     float m_sampleRate;
     float m_decay{0.1f};
+    float m_centerDecay{0.02f + 0.1f * 30.f};
+    bool m_lazyDecay{true};
+    uint32_t m_decayGeneration{0};
+    size_t m_refreshCursor{NumElements};
     size_t m_countVoices{0};
     size_t lastCnt = 0;
     size_t cntActive = 0;
+    float m_audibleLevel{1E-5f}; // -100 dBFS
+    bool m_dampMode{false};
+    CollisionPolicy m_collisionPolicy{CollisionPolicy::Queue};
+    size_t m_numRates{1};
+    size_t m_maxActive{NumElements};
 
     std::array<float, NumElements> m_frequencies{};
-    std::array<AbacDsp::BiquadResoBP, NumElements> m_bq{};
+    std::array<float, NumElements> m_compensation{};
+    std::array<float, NumElements> m_octavesFromMiddleC{};
+    std::array<float, NumElements> m_slotDecay{};
+    std::array<uint32_t, NumElements> m_slotGeneration{};
+    std::conditional_t<UseResoBank, NoEngine, std::array<AbacDsp::BiquadResoBP, NumElements>> m_bq{};
     Excitation m_excitation;
+    ExcitationBursts<NumElements> m_bursts;
+    std::conditional_t<UseResoBank, ResoBank<BlockSize, NumElements, NumOutputs>, NoEngine> m_bank;
+    TriggerQueue<16384> m_triggerQueue;
+    std::vector<RateBuffers> m_partials;
+    RateBuffers m_rateOut{};
+    std::array<std::array<HalfBandInterpolator<BlockSize / 2>, NumOutputs>, NumRates - 1> m_interpolators{};
+    ExcitationOverflow<NumElements, OverflowCursors> m_overflow;
+    std::unique_ptr<ResoWorkerPool> m_workers;
     std::array<size_t, NumElements> m_triggerWait{};
+    std::array<size_t, NumElements> m_triggerOffset{};
     std::array<float, NumElements> m_trigger{};
     std::array<float, NumElements> m_triggerGain{};
+    std::array<uint32_t, NumElements> m_noiseCursor{};
     std::array<float, NumElements> m_phaseAdvance{};
+    std::array<float, NumElements> m_exactAdvance{};
+    bool m_burstsMatch{false};
     std::array<int, NumElements> m_activeState{};
+    std::array<uint32_t, NumElements> m_activeList{};
+    std::array<float, NumElements> m_level{};
+    std::array<float, NumElements> m_levelRelease{};
+    std::array<uint8_t, NumElements> m_slotShift{};
+    std::array<ChannelGains, NumElements> m_channelGains{};
+    std::array<uint8_t, NumElements> m_slotOwner{};
+    std::array<bool, NumElements> m_slotDamped{};
+    std::array<std::pair<float, uint32_t>, NumElements> m_levelOrder{};
 };
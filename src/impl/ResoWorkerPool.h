@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*
+ * Fixed pool of render workers. run() executes job(0) on the calling thread and job(1..n) on the workers, and
+ * returns once all of them finished. Between blocks a worker first spins in a pause loop, so a block that
+ * follows closely wakes it with a cache line transfer rather than a scheduler round trip; once the spin budget
+ * is used up it sleeps in std::atomic::wait until the next run(), so a silent instance costs no CPU. The
+ * calling thread only waits within run() and yields after the budget. With pinToCores on Linux worker k is
+ * pinned to core k, which only helps when a single instance owns the machine, so it is off by default.
+ */
+class ResoWorkerPool
+{
+  public:
+    using Job = std::function<void(size_t)>;
+
+    ResoWorkerPool(const size_t numWorkers, Job job, const bool pinToCores = false)
+        : m_job(std::move(job))
+    {
+        m_threads.reserve(numWorkers);
+        for (size_t w = 1; w <= numWorkers; ++w)
+        {
+            m_threads.emplace_back([this, w] { workerLoop(w); });
+            if (pinToCores)
+            {
+                pinToCore(m_threads.back(), w);
+            }
+        }
+    }
+
+    ResoWorkerPool(const ResoWorkerPool&) = delete;
+    ResoWorkerPool& operator=(const ResoWorkerPool&) = delete;
+
+    ~ResoWorkerPool()
+    {
+        m_stop.store(true, std::memory_order_release);
+        m_epoch.fetch_add(1, std::memory_order_release);
+        m_epoch.notify_all();
+        for (auto& t : m_threads)
+        {
+            t.join();
+        }
+    }
+
+    [[nodiscard]] size_t numPartitions() const noexcept
+    {
+        return m_threads.size() + 1;
+    }
+
+    void run() noexcept
+    {
+        m_done.store(0, std::memory_order_relaxed);
+        m_epoch.fetch_add(1, std::memory_order_release);
+        m_epoch.notify_all();
+        m_job(0);
+        size_t spins = 0;
+        while (m_done.load(std::memory_order_acquire) != m_threads.size())
+        {
+            backOff(spins);
+        }
+    }
+
+  private:
+    static constexpr size_t SpinBudget{4096};
+
+    // pauses first, yields once the spin budget is used up so an oversubscribed machine still progresses
+    static void backOff(size_t& spins) noexcept
+    {
+        if (++spins < SpinBudget)
+        {
+            cpuRelax();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    static void cpuRelax() noexcept
+    {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+        _mm_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    static void pinToCore([[maybe_unused]] std::thread& thread, [[maybe_unused]] const size_t core)
+    {
+#if defined(__linux__)
+        if (core >= std::thread::hardware_concurrency())
+        {
+            return;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#endif
+    }
+
+    void workerLoop(const size_t index)
+    {
+        // the epoch starts at 0, reading it here could already see the first run() and skip that job
+        uint64_t seen = 0;
+        size_t spins = 0;
+        while (true)
+        {
+            const auto epoch = m_epoch.load(std::memory_order_acquire);
+            // the destructor sets m_stop before it bumps the epoch to wake the sleepers
+            if (m_stop.load(std::memory_order_acquire))
+            {
+                return;
+            }
+            if (epoch == seen)
+            {
+                if (++spins < SpinBudget)
+                {
+                    cpuRelax();
+                }
+                else
+                {
+                    m_epoch.wait(seen, std::memory_order_acquire);
+                }
+                continue;
+            }
+            seen = epoch;
+            spins = 0;
+            m_job(index);
+            m_done.fetch_add(1, std::memory_order_acq_rel);
+        }
+    }
+
+    Job m_job;
+    std::vector<std::thread> m_threads;
+    alignas(64) std::atomic<uint64_t> m_epoch{0};
+    alignas(64) std::atomic<size_t> m_done{0};
+    std::atomic<bool> m_stop{false};
+};
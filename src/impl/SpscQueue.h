@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Fixed capacity single producer / single consumer ring. A full queue drops the event and counts it
+ * instead of blocking the producer, so pushing from the audio thread has a bounded cost.
+ */
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+  public:
+    bool push(const T& event) noexcept
+    {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == Capacity)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_events[head & Mask] = event;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // counts an event the producer refused to push, e.g. an invalid one, with the dropped ones
+    void reject() noexcept
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    template <typename Consumer>
+    size_t drain(Consumer&& consumer) noexcept
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        const auto head = m_head.load(std::memory_order_acquire);
+        for (auto t = tail; t != head; ++t)
+        {
+            consumer(m_events[t & Mask]);
+        }
+        m_tail.store(head, std::memory_order_release);
+        return head - tail;
+    }
+
+    // consumer side peek, nullptr when empty
+    [[nodiscard]] const T* front() const noexcept
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+        return &m_events[tail & Mask];
+    }
+
+    void pop() noexcept
+    {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] size_t droppedCount() const noexcept
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    static constexpr size_t capacity() noexcept
+    {
+        return Capacity;
+    }
+
+  private:
+    static constexpr size_t Mask{Capacity - 1};
+
+    std::array<T, Capacity> m_events{};
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+    std::atomic<size_t> m_dropped{0};
+};
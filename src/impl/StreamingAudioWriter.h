@@ -0,0 +1,308 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AudioFile.h"
+
+/*
+ * Writes a WAV or AIFF file of unbounded length with constant memory. The audio thread appends interleaved
+ * float frames to a single producer / single consumer ring with write(), which never blocks or allocates: a
+ * full ring drops the frames and counts them. A disk thread converts and writes whatever is in the ring and
+ * close() patches the chunk sizes into the header. The files match AudioFile<float>::save() byte for byte:
+ * 32 bit WAV is float, everything else integer PCM. The 32 bit size fields limit a file to 4 GiB, about
+ * three hours of 48 kHz stereo float; later frames are dropped.
+ */
+class StreamingAudioWriter
+{
+  public:
+    StreamingAudioWriter() = default;
+    StreamingAudioWriter(const StreamingAudioWriter&) = delete;
+    StreamingAudioWriter& operator=(const StreamingAudioWriter&) = delete;
+
+    ~StreamingAudioWriter()
+    {
+        close();
+    }
+
+    // bitDepth 16, 24 or 32; the ring holds ringFrames frames, rounded up to a power of two. Not real-time safe.
+    bool open(const std::string& path, const AudioFileFormat format, const uint32_t sampleRate,
+              const size_t numChannels, const int bitDepth, const size_t ringFrames = size_t{1} << 16)
+    {
+        close();
+        if ((format != AudioFileFormat::Wave && format != AudioFileFormat::Aiff) || numChannels == 0 ||
+            (bitDepth != 16 && bitDepth != 24 && bitDepth != 32))
+        {
+            return false;
+        }
+        m_file = std::fopen(path.c_str(), "wb");
+        if (!m_file)
+        {
+            return false;
+        }
+        m_format = format;
+        m_sampleRate = sampleRate;
+        m_numChannels = numChannels;
+        m_bitDepth = bitDepth;
+        m_float = format == AudioFileFormat::Wave && bitDepth == 32;
+        m_bytesPerFrame = numChannels * static_cast<size_t>(bitDepth / 8);
+        m_maxFrames = (UINT32_MAX - 64) / m_bytesPerFrame;
+
+        size_t capacity = 1;
+        while (capacity < ringFrames * numChannels)
+        {
+            capacity <<= 1;
+        }
+        m_ring.assign(capacity, 0.f);
+        m_bytes.resize(ChunkSamples * 4);
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+        m_frames = 0;
+        m_dropped.store(0, std::memory_order_relaxed);
+        m_failed.store(false, std::memory_order_relaxed);
+        m_stop.store(false, std::memory_order_relaxed);
+
+        const auto header = makeHeader(0);
+        if (std::fwrite(header.data(), 1, header.size(), m_file) != header.size())
+        {
+            std::fclose(m_file);
+            m_file = nullptr;
+            return false;
+        }
+        m_thread = std::thread([this] { diskLoop(); });
+        return true;
+    }
+
+    [[nodiscard]] bool isOpen() const noexcept
+    {
+        return m_file != nullptr;
+    }
+
+    // frames write() accepts right now, for producers that would rather wait than drop
+    [[nodiscard]] size_t freeFrames() const noexcept
+    {
+        const auto used = m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_acquire);
+        return (m_ring.size() - used) / m_numChannels;
+    }
+
+    // appends numFrames interleaved frames, all or nothing; false and counted as dropped when they do not fit
+    bool write(const float* interleaved, const size_t numFrames) noexcept
+    {
+        if (!m_file)
+        {
+            return false;
+        }
+        const auto numSamples = numFrames * m_numChannels;
+        const auto head = m_head.load(std::memory_order_relaxed);
+        const auto used = head - m_tail.load(std::memory_order_acquire);
+        if (m_ring.size() - used < numSamples || m_maxFrames - m_frames < numFrames)
+        {
+            m_dropped.fetch_add(numFrames, std::memory_order_relaxed);
+            return false;
+        }
+        const auto mask = m_ring.size() - 1;
+        const auto first = std::min(numSamples, m_ring.size() - (head & mask));
+        std::memcpy(m_ring.data() + (head & mask), interleaved, first * sizeof(float));
+        std::memcpy(m_ring.data(), interleaved + first, (numSamples - first) * sizeof(float));
+        m_frames += numFrames;
+        m_head.store(head + numSamples, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]] size_t droppedFrames() const noexcept
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    // writes out the ring, patches the header and closes the file; false if any write failed. Call it once the
+    // producer has stopped writing.
+    bool close()
+    {
+        if (!m_file)
+        {
+            return true;
+        }
+        m_stop.store(true, std::memory_order_release);
+        m_thread.join();
+        const auto header = makeHeader(m_frames);
+        if (std::fseek(m_file, 0, SEEK_SET) != 0 ||
+            std::fwrite(header.data(), 1, header.size(), m_file) != header.size())
+        {
+            m_failed.store(true, std::memory_order_relaxed);
+        }
+        if (std::fclose(m_file) != 0)
+        {
+            m_failed.store(true, std::memory_order_relaxed);
+        }
+        m_file = nullptr;
+        m_ring.clear();
+        m_ring.shrink_to_fit();
+        return !m_failed.load(std::memory_order_relaxed);
+    }
+
+  private:
+    static constexpr size_t ChunkSamples{size_t{1} << 14};
+
+    void diskLoop()
+    {
+        while (true)
+        {
+            // everything written before stop was set is in the ring once stop is seen
+            const auto stopping = m_stop.load(std::memory_order_acquire);
+            if (drain() == 0)
+            {
+                if (stopping)
+                {
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    size_t drain()
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        const auto available = m_head.load(std::memory_order_acquire) - tail;
+        const auto mask = m_ring.size() - 1;
+        size_t done = 0;
+        while (done < available)
+        {
+            const auto begin = (tail + done) & mask;
+            const auto count = std::min({available - done, m_ring.size() - begin, ChunkSamples});
+            const auto numBytes = encode(m_ring.data() + begin, count);
+            if (!m_failed.load(std::memory_order_relaxed) &&
+                std::fwrite(m_bytes.data(), 1, numBytes, m_file) != numBytes)
+            {
+                m_failed.store(true, std::memory_order_relaxed);
+            }
+            done += count;
+            m_tail.store(tail + done, std::memory_order_release);
+        }
+        return done;
+    }
+
+    size_t encode(const float* samples, const size_t count) noexcept
+    {
+        const auto little = m_format == AudioFileFormat::Wave;
+        auto* dst = m_bytes.data();
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (m_bitDepth == 16)
+            {
+                dst = put(dst, static_cast<uint16_t>(AudioSampleConverter<float>::sampleToSixteenBitInt(samples[i])),
+                          2, little);
+            }
+            else if (m_bitDepth == 24)
+            {
+                dst = put(dst,
+                          static_cast<uint32_t>(AudioSampleConverter<float>::sampleToTwentyFourBitInt(samples[i])),
+                          3, little);
+            }
+            else if (m_float)
+            {
+                uint32_t bits;
+                std::memcpy(&bits, samples + i, sizeof(bits));
+                dst = put(dst, bits, 4, little);
+            }
+            else
+            {
+                dst = put(dst,
+                          static_cast<uint32_t>(AudioSampleConverter<float>::sampleToThirtyTwoBitInt(samples[i])),
+                          4, little);
+            }
+        }
+        return static_cast<size_t>(dst - m_bytes.data());
+    }
+
+    static uint8_t* put(uint8_t* dst, const uint32_t value, const size_t numBytes, const bool littleEndian) noexcept
+    {
+        for (size_t b = 0; b < numBytes; ++b)
+        {
+            const auto shift = 8 * (littleEndian ? b : numBytes - 1 - b);
+            *dst++ = static_cast<uint8_t>(value >> shift);
+        }
+        return dst;
+    }
+
+    // the same layout AudioFile writes, sizes for numFrames frames
+    [[nodiscard]] std::vector<uint8_t> makeHeader(const size_t numFrames) const
+    {
+        const auto dataBytes = static_cast<uint32_t>(numFrames * m_bytesPerFrame);
+        const auto channels = static_cast<uint32_t>(m_numChannels);
+        const auto bits = static_cast<uint32_t>(m_bitDepth);
+        std::vector<uint8_t> header;
+        header.reserve(64);
+        const auto tag = [&header](const char* id) { header.insert(header.end(), id, id + 4); };
+        const auto number = [&header, this](const uint32_t value, const size_t numBytes)
+        {
+            header.resize(header.size() + numBytes);
+            put(header.data() + header.size() - numBytes, value, numBytes, m_format == AudioFileFormat::Wave);
+        };
+        if (m_format == AudioFileFormat::Wave)
+        {
+            const uint32_t formatChunkSize = m_float ? 18 : 16;
+            tag("RIFF");
+            number(4 + formatChunkSize + 8 + 8 + dataBytes, 4);
+            tag("WAVE");
+            tag("fmt ");
+            number(formatChunkSize, 4);
+            number(m_float ? 3 : 1, 2);
+            number(channels, 2);
+            number(m_sampleRate, 4);
+            number(m_sampleRate * channels * bits / 8, 4);
+            number(channels * bits / 8, 2);
+            number(bits, 2);
+            if (m_float)
+            {
+                number(0, 2);
+            }
+            tag("data");
+            number(dataBytes, 4);
+        }
+        else
+        {
+            tag("FORM");
+            number(4 + 26 + 16 + dataBytes, 4);
+            tag("AIFF");
+            tag("COMM");
+            number(18, 4);
+            number(channels, 2);
+            number(static_cast<uint32_t>(numFrames), 4);
+            number(bits, 2);
+            uint8_t rate[10];
+            AiffUtilities::encodeAiffSampleRate(static_cast<double>(m_sampleRate), rate);
+            header.insert(header.end(), rate, rate + 10);
+            tag("SSND");
+            number(dataBytes + 8, 4);
+            number(0, 4);
+            number(0, 4);
+        }
+        return header;
+    }
+
+    std::FILE* m_file{nullptr};
+    AudioFileFormat m_format{AudioFileFormat::Wave};
+    uint32_t m_sampleRate{48000};
+    size_t m_numChannels{1};
+    int m_bitDepth{32};
+    bool m_float{true};
+    size_t m_bytesPerFrame{4};
+    size_t m_maxFrames{0};
+    size_t m_frames{0};
+    std::vector<float> m_ring;
+    std::vector<uint8_t> m_bytes;
+    std::thread m_thread;
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+    std::atomic<size_t> m_dropped{0};
+    std::atomic<bool> m_failed{false};
+    std::atomic<bool> m_stop{false};
+};
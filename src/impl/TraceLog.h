@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+#include "MpscQueue.h"
+
+/*
+ * Real-time safe diagnostics. The audio thread only copies a binary record into a preallocated ring,
+ * a background thread formats and prints it to stderr. The log is shared by all generator instances of the
+ * process, whose audio threads may differ, so the ring takes several producers. Opt-in: compiled in only
+ * when PINGSYNTH_ENABLE_TRACE is defined (the PINGSYNTH_TRACE CMake option), PINGSYNTH_DISABLE_TRACE
+ * overrides it. Otherwise the arguments of PINGSYNTH_TRACE are not evaluated.
+ */
+#if defined(PINGSYNTH_ENABLE_TRACE) && !defined(PINGSYNTH_DISABLE_TRACE)
+#define PINGSYNTH_TRACE_ENABLED 1
+#else
+#define PINGSYNTH_TRACE_ENABLED 0
+#endif
+
+enum class TraceKind : uint8_t
+{
+    ResonatorTrigger, // slot, frequency, power
+    VoiceTrigger,     // note, frequency
+    Spread,           // beat delta, random offset
+};
+
+struct TraceRecord
+{
+    TraceKind kind;
+    uint32_t index;
+    float a;
+    float b;
+};
+
+class TraceLog
+{
+  public:
+    static TraceLog& instance()
+    {
+        static TraceLog log;
+        return log;
+    }
+
+    void write(const TraceKind kind, const size_t index, const float a = 0.f, const float b = 0.f) noexcept
+    {
+        m_records.push({kind, static_cast<uint32_t>(index), a, b});
+    }
+
+    TraceLog(const TraceLog&) = delete;
+    TraceLog& operator=(const TraceLog&) = delete;
+
+    ~TraceLog()
+    {
+        m_running.store(false);
+        m_worker.join();
+        flush();
+    }
+
+  private:
+    TraceLog()
+        : m_worker([this] { run(); })
+    {
+    }
+
+    void run()
+    {
+        while (m_running.load())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            flush();
+        }
+    }
+
+    void flush()
+    {
+        const auto count = m_records.drain([](const TraceRecord& r) { print(r); });
+        const auto dropped = m_records.droppedCount();
+        if (dropped != m_reportedDrops)
+        {
+            std::fprintf(stderr, "trace: %zu records dropped\n", dropped - m_reportedDrops);
+            m_reportedDrops = dropped;
+        }
+        if (count)
+        {
+            std::fflush(stderr);
+        }
+    }
+
+    static void print(const TraceRecord& r)
+    {
+        switch (r.kind)
+        {
+            case TraceKind::ResonatorTrigger:
+                std::fprintf(stderr, "%u\t%g\t%g\n", r.index, r.a, r.b);
+                break;
+            case TraceKind::VoiceTrigger:
+                std::fprintf(stderr, "\n%u\t%g\n", r.index, r.a);
+                break;
+            case TraceKind::Spread:
+                std::fprintf(stderr, "%u\t%g\n", r.index, r.a);
+                break;
+        }
+    }
+
+    MpscQueue<TraceRecord, 16384> m_records;
+    size_t m_reportedDrops{0};
+    std::atomic<bool> m_running{true};
+    std::thread m_worker;
+};
+
+#if PINGSYNTH_TRACE_ENABLED
+#define PINGSYNTH_TRACE(...) TraceLog::instance().write(__VA_ARGS__)
+#define PINGSYNTH_TRACE_START() static_cast<void>(TraceLog::instance())
+#else
+#define PINGSYNTH_TRACE(...) static_cast<void>(0)
+#define PINGSYNTH_TRACE_START() static_cast<void>(0)
+#endif
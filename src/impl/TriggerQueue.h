@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+#include "SpscQueue.h"
+
+enum class TriggerKind : uint8_t
+{
+    Start,     // excite resonator index
+    DampOwner, // damp the running resonators of owner, index unused
+};
+
+struct TriggerEvent
+{
+    uint32_t index;
+    float gain;
+    uint32_t waitBlocks;
+    uint32_t sampleOffset;
+    float pan; // 0 first output ... 1 last output
+    uint8_t owner;
+    TriggerKind kind;
+};
+
+// filled by the harmonic generators, drained by ResoGenerator at the start of each block
+template <size_t Capacity>
+using TriggerQueue = SpscQueue<TriggerEvent, Capacity>;
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <initializer_list>
+#include <type_traits>
+#include <vector>
+
+#include "impl/ResoGenerator.h"
+
+namespace
+{
+constexpr size_t BlockSize{16};
+constexpr size_t NumElements{97};
+constexpr size_t Slot{96};           // 110 Hz, its burst of two periods runs for about 55 blocks
+constexpr size_t RetriggerBlock{20}; // well inside that burst
+constexpr size_t LateBlock{200};     // after it
+constexpr size_t NumBlocks{600};
+
+struct Hit
+{
+    size_t block;
+    float power;
+};
+
+template <bool BankEngine>
+std::vector<float> render(const CollisionPolicy policy, const std::initializer_list<Hit> hits)
+{
+    ResoGenerator<BlockSize, NumElements, 1, BankEngine> generator{48000.f, 21, 4};
+    generator.setDecay(0.05f);
+    generator.setExcitationNoise(0.f);
+    generator.setCollisionPolicy(policy);
+    std::vector<float> out;
+    out.reserve(NumBlocks * BlockSize);
+    for (size_t block = 0; block < NumBlocks; ++block)
+    {
+        for (const auto& hit : hits)
+        {
+            if (hit.block == block)
+            {
+                generator.triggerNew(Slot, hit.power, 0);
+            }
+        }
+        std::array<float, BlockSize> samples{};
+        generator.processBlock(samples);
+        out.insert(out.end(), samples.begin(), samples.end());
+    }
+    return out;
+}
+
+float peak(const std::vector<float>& signal)
+{
+    float result = 0.f;
+    for (const auto v : signal)
+    {
+        result = std::max(result, std::abs(v));
+    }
+    return result;
+}
+
+// max |a + scale * b - c|
+float mismatch(const std::vector<float>& a, const float scale, const std::vector<float>& b, const std::vector<float>& c)
+{
+    float result = 0.f;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        result = std::max(result, std::abs(a[i] + scale * b[i] - c[i]));
+    }
+    return result;
+}
+
+float maxDifference(const std::vector<float>& a, const std::vector<float>& b)
+{
+    return mismatch(a, 0.f, a, b);
+}
+
+std::vector<float> difference(const std::vector<float>& a, const std::vector<float>& b)
+{
+    std::vector<float> result(a.size());
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        result[i] = a[i] - b[i];
+    }
+    return result;
+}
+} // namespace
+
+template <typename T>
+class CollisionPolicyTest : public ::testing::Test
+{
+  protected:
+    static std::vector<float> run(const CollisionPolicy policy, const std::initializer_list<Hit> hits)
+    {
+        return render<T::value>(policy, hits);
+    }
+
+    // the retriggers below only collide if the first burst is still running
+    const std::vector<float> single = run(CollisionPolicy::Replace, {{0, 1.f}});
+    const float tolerance = 1E-3f * peak(single);
+};
+
+using Engines = ::testing::Types<std::false_type, std::true_type>;
+TYPED_TEST_SUITE(CollisionPolicyTest, Engines);
+
+TYPED_TEST(CollisionPolicyTest, queueRunsBothExcitations)
+{
+    // the resonator is linear: both bursts in one slot sound like two separate hits
+    const auto late = this->run(CollisionPolicy::Replace, {{RetriggerBlock, 0.5f}});
+    const auto queued = this->run(CollisionPolicy::Queue, {{0, 1.f}, {RetriggerBlock, 0.5f}});
+    EXPECT_GT(peak(this->single), 0.f);
+    EXPECT_LT(mismatch(this->single, 1.f, late, queued), this->tolerance);
+}
+
+TYPED_TEST(CollisionPolicyTest, replaceCutsTheRunningBurst)
+{
+    const auto queued = this->run(CollisionPolicy::Queue, {{0, 1.f}, {RetriggerBlock, 1.f}});
+    const auto replaced = this->run(CollisionPolicy::Replace, {{0, 1.f}, {RetriggerBlock, 1.f}});
+    // Queue minus Replace is what is left of the first burst after the retrigger
+    const auto rest = difference(queued, replaced);
+    EXPECT_GT(peak(rest), 10.f * this->tolerance);
+    EXPECT_LT(peak(std::vector<float>(rest.begin(), rest.begin() + RetriggerBlock * BlockSize)), this->tolerance);
+}
+
+TYPED_TEST(CollisionPolicyTest, sumAddsToTheRunningBurst)
+{
+    const auto queued = this->run(CollisionPolicy::Queue, {{0, 1.f}, {RetriggerBlock, 1.f}});
+    const auto replaced = this->run(CollisionPolicy::Replace, {{0, 1.f}, {RetriggerBlock, 1.f}});
+    const auto summed = this->run(CollisionPolicy::Sum, {{0, 1.f}, {RetriggerBlock, 0.5f}});
+    // the cursor keeps running, only the rest of the burst is louder; a restart would add a whole burst
+    EXPECT_LT(mismatch(this->single, 0.5f, difference(queued, replaced), summed), this->tolerance);
+}
+
+TYPED_TEST(CollisionPolicyTest, maxKeepsTheLouderGain)
+{
+    const auto softer = this->run(CollisionPolicy::Max, {{0, 1.f}, {RetriggerBlock, 0.5f}});
+    EXPECT_LT(maxDifference(softer, this->single), this->tolerance);
+
+    // a louder hit raises the rest of the running burst to its gain, without a restart
+    const auto queued = this->run(CollisionPolicy::Queue, {{0, 1.f}, {RetriggerBlock, 1.f}});
+    const auto replaced = this->run(CollisionPolicy::Replace, {{0, 1.f}, {RetriggerBlock, 1.f}});
+    const auto louder = this->run(CollisionPolicy::Max, {{0, 1.f}, {RetriggerBlock, 1.5f}});
+    EXPECT_LT(mismatch(this->single, 0.5f, difference(queued, replaced), louder), this->tolerance);
+}
+
+TYPED_TEST(CollisionPolicyTest, finishedBurstDoesNotCollide)
+{
+    // once the first burst is over every policy starts a fresh one
+    const auto late = this->run(CollisionPolicy::Replace, {{LateBlock, 0.5f}});
+    for (const auto policy : {CollisionPolicy::Sum, CollisionPolicy::Max, CollisionPolicy::Queue})
+    {
+        const auto hits = this->run(policy, {{0, 1.f}, {LateBlock, 0.5f}});
+        EXPECT_LT(mismatch(this->single, 1.f, late, hits), this->tolerance) << static_cast<int>(policy);
+    }
+}
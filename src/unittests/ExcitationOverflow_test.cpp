@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <array>
+
+#include "impl/ExcitationOverflow.h"
+
+namespace
+{
+constexpr size_t NumElements{8};
+constexpr size_t Capacity{4};
+constexpr size_t BlockSize{64};
+constexpr float Advance{64.f}; // the 1024 point pattern lasts 16 samples
+constexpr float Start{1023.f};
+
+struct Pool
+{
+    Excitation excitation{1024};
+    ExcitationBursts<NumElements> bursts{excitation};
+    ExcitationOverflow<NumElements, Capacity> overflow;
+
+    bool add(const size_t slot, const size_t waitBlocks = 0)
+    {
+        return overflow.add(slot, Start, Advance, 1.f, waitBlocks, 0, 0);
+    }
+
+    // one block of the cursors of slot
+    std::array<float, BlockSize> block(const size_t slot)
+    {
+        std::array<float, BlockSize> out{};
+        overflow.beginBlock();
+        overflow.render(slot, out.data(), BlockSize, 1, bursts);
+        overflow.endBlock();
+        return out;
+    }
+};
+
+bool silent(const std::array<float, BlockSize>& block)
+{
+    for (const auto v : block)
+    {
+        if (v != 0.f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+TEST(ExcitationOverflowTest, exhaustedPoolRejects)
+{
+    Pool pool;
+    EXPECT_TRUE(pool.overflow.empty());
+    for (size_t c = 0; c < Capacity; ++c)
+    {
+        EXPECT_TRUE(pool.add(c % 2));
+    }
+    EXPECT_FALSE(pool.add(3)) << "all cursors are in use";
+    EXPECT_FALSE(pool.overflow.pending(3)) << "a rejected add must not mark its slot";
+    EXPECT_TRUE(pool.overflow.pending(0));
+    EXPECT_TRUE(pool.overflow.pending(1));
+
+    // the bursts of slot 0 finish within the block and give their cursors back
+    EXPECT_FALSE(silent(pool.block(0)));
+    EXPECT_FALSE(pool.overflow.pending(0));
+    EXPECT_TRUE(pool.overflow.pending(1));
+    EXPECT_TRUE(pool.add(3));
+    EXPECT_TRUE(pool.add(3));
+    EXPECT_FALSE(pool.add(3));
+}
+
+TEST(ExcitationOverflowTest, waitingCursorsHoldTheirPlace)
+{
+    Pool pool;
+    ASSERT_TRUE(pool.add(2, 2));
+    EXPECT_TRUE(silent(pool.block(2)));
+    EXPECT_TRUE(pool.overflow.pending(2));
+    EXPECT_FALSE(silent(pool.block(2)));
+    EXPECT_FALSE(pool.overflow.pending(2));
+    EXPECT_TRUE(pool.overflow.empty());
+}
+
+TEST(ExcitationOverflowTest, droppedSlotFreesItsCursors)
+{
+    Pool pool;
+    for (size_t c = 0; c < Capacity; ++c)
+    {
+        ASSERT_TRUE(pool.add(5));
+    }
+    pool.overflow.dropSlot(5);
+    EXPECT_TRUE(pool.overflow.pending(5)) << "freed at the end of the block";
+    pool.overflow.endBlock();
+    EXPECT_FALSE(pool.overflow.pending(5));
+    EXPECT_TRUE(pool.overflow.empty());
+    EXPECT_TRUE(pool.add(6));
+}
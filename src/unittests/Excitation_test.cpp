@@ -3,9 +3,47 @@
 #include <vector>
 #include <cmath>
 #include <numbers>
+#include <algorithm>
+#include <array>
+#include <cstdint>
 
 #include "impl/PingExcitation.h"
 
+namespace
+{
+constexpr size_t PatternLength{1024};
+constexpr float Advance{PatternLength / 200.f}; // the sine lasts 200 samples
+// the shapes match the sine at the resonator frequency, the impulse (about 50) packs all of it into one sample
+constexpr float MaxPeak{64.f};
+
+struct Burst
+{
+    std::vector<float> samples;
+    size_t written;
+};
+
+Burst renderBurst(const Excitation& excitation)
+{
+    Burst burst{std::vector<float>(400, 0.f), 0};
+    auto position = static_cast<float>(PatternLength - 1);
+    uint32_t noiseCursor = Excitation::noiseStart(7);
+    burst.written = excitation.render(burst.samples.data(), 1, burst.samples.size(), position, Advance, 1.f,
+                                      noiseCursor);
+    EXPECT_LE(position, 0.f);
+    return burst;
+}
+
+float peak(const std::vector<float>& samples)
+{
+    float result = 0.f;
+    for (const auto v : samples)
+    {
+        result = std::max(result, std::abs(v));
+    }
+    return result;
+}
+} // namespace
+
 TEST(ExcitationTest, generalFunctionality)
 {
     constexpr auto sampleRate{48000.f};
@@ -37,4 +75,56 @@ TEST(ExcitationTest, generalFunctionality)
     EXPECT_NEAR(output[122], -0.87035f, 1E-1f);
     EXPECT_NEAR(output[150], 0, 1E-1f);
     EXPECT_NEAR(output[164], 0.2217, 1E-1f);
-}
\ No newline at end of file
+}
+TEST(ExcitationTest, everyShapeRendersABoundedBurst)
+{
+    struct Expected
+    {
+        ExcitationShape shape;
+        size_t length;
+    };
+    constexpr std::array<Expected, 6> shapes{{{ExcitationShape::Sine, 200},
+                                              {ExcitationShape::Impulse, 1},
+                                              {ExcitationShape::Click, 25},
+                                              {ExcitationShape::Mallet, 50},
+                                              {ExcitationShape::Sample, 200},
+                                              {ExcitationShape::FilteredNoise, 200}}};
+    Excitation excitation(PatternLength);
+    for (const auto& expected : shapes)
+    {
+        excitation.setShape(expected.shape);
+        const auto start = static_cast<float>(PatternLength - 1);
+        EXPECT_EQ(excitation.renderLength(start, Advance), expected.length);
+        const auto burst = renderBurst(excitation);
+        EXPECT_EQ(burst.written, expected.length) << "shape " << static_cast<int>(expected.shape);
+        const std::vector<float> head(burst.samples.begin(), burst.samples.begin() + burst.written);
+        const std::vector<float> tail(burst.samples.begin() + burst.written, burst.samples.end());
+        EXPECT_GT(peak(head), 0.f) << "shape " << static_cast<int>(expected.shape);
+        EXPECT_LT(peak(head), MaxPeak) << "shape " << static_cast<int>(expected.shape);
+        EXPECT_EQ(peak(tail), 0.f) << "shape " << static_cast<int>(expected.shape);
+    }
+}
+
+TEST(ExcitationTest, sampleReplacesThePattern)
+{
+    Excitation excitation(PatternLength);
+    excitation.setShape(ExcitationShape::Sample);
+    const auto sine = renderBurst(excitation);
+
+    const std::array<float, 1> tooShort{1.f};
+    EXPECT_FALSE(excitation.setSample(tooShort));
+    EXPECT_EQ(renderBurst(excitation).samples, sine.samples);
+
+    // a square wave, squeezed into the pattern and rendered with the length of the sine burst
+    std::vector<float> square(300);
+    for (size_t i = 0; i < square.size(); ++i)
+    {
+        square[i] = (i / 50) % 2 == 0 ? 0.5f : -0.5f;
+    }
+    ASSERT_TRUE(excitation.setSample(square));
+    const auto burst = renderBurst(excitation);
+    EXPECT_EQ(burst.written, sine.written);
+    EXPECT_NE(burst.samples, sine.samples);
+    EXPECT_GT(peak(burst.samples), 0.f);
+    EXPECT_LT(peak(burst.samples), MaxPeak);
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "impl/FrequencyIndexMapper.h"
+
+namespace
+{
+// the grid of PingSynth: MIDI 17 ... 132 at 66 slots per semitone
+constexpr int MinMidiNote{17};
+constexpr double SlotsPerOctave{66.0 * 12.0};
+constexpr size_t NumSlots{115 * 66 + 1};
+const double BaseFrequency{440.0 * std::pow(2.0, (MinMidiNote - 69) / 12.0)};
+
+FrequencyIndexMapper makeMapper()
+{
+    return {static_cast<float>(BaseFrequency), static_cast<float>(SlotsPerOctave), NumSlots};
+}
+
+// the fractional slot of frequency, in double precision
+double exactSlot(const float frequency)
+{
+    return std::log2(static_cast<double>(frequency) / BaseFrequency) * SlotsPerOctave;
+}
+
+size_t exactIndex(const float frequency)
+{
+    return static_cast<size_t>(std::clamp(std::round(exactSlot(frequency)), 0.0, static_cast<double>(NumSlots - 1)));
+}
+} // namespace
+
+TEST(FrequencyIndexMapperTest, slotCentresMapToTheirSlot)
+{
+    const auto mapper = makeMapper();
+    for (size_t slot = 0; slot < NumSlots; ++slot)
+    {
+        const auto frequency =
+            static_cast<float>(BaseFrequency * std::exp2(static_cast<double>(slot) / SlotsPerOctave));
+        ASSERT_EQ(mapper(frequency), slot) << frequency << " Hz";
+    }
+}
+
+TEST(FrequencyIndexMapperTest, matchesExactLog2OverTheWholeGrid)
+{
+    const auto mapper = makeMapper();
+    constexpr size_t StepsPerSlot{32};
+    // within 0.002 slots of a rounding boundary the table may round to the other neighbour
+    constexpr double BoundaryTolerance{0.002};
+    size_t nearBoundary = 0;
+    for (size_t step = 0; step < (NumSlots + 1) * StepsPerSlot; ++step)
+    {
+        const auto slot = static_cast<double>(step) / StepsPerSlot - 0.5;
+        const auto frequency = static_cast<float>(BaseFrequency * std::exp2(slot / SlotsPerOctave));
+        const auto expected = exactIndex(frequency);
+        const auto actual = mapper(frequency);
+        if (actual == expected)
+        {
+            continue;
+        }
+        const auto exact = exactSlot(frequency);
+        ASSERT_LT(std::abs(exact - std::floor(exact) - 0.5), BoundaryTolerance) << frequency << " Hz";
+        ASSERT_EQ(std::max(actual, expected) - std::min(actual, expected), 1u) << frequency << " Hz";
+        ++nearBoundary;
+    }
+    // the sweep puts one frequency on or right next to every boundary, only those may differ
+    EXPECT_LE(nearBoundary, NumSlots);
+}
+
+TEST(FrequencyIndexMapperTest, clampsOutsideTheGrid)
+{
+    const auto mapper = makeMapper();
+    const auto base = static_cast<float>(BaseFrequency);
+    EXPECT_EQ(mapper(base), 0u);
+    EXPECT_EQ(mapper(base * 0.5f), 0u);
+    EXPECT_EQ(mapper(1E-20f), 0u);
+    EXPECT_EQ(mapper(0.f), 0u);
+    EXPECT_EQ(mapper(-440.f), 0u);
+    EXPECT_EQ(mapper(std::numeric_limits<float>::quiet_NaN()), 0u);
+    EXPECT_EQ(mapper(30000.f), NumSlots - 1);
+    EXPECT_EQ(mapper(1E30f), NumSlots - 1);
+    EXPECT_EQ(mapper(std::numeric_limits<float>::infinity()), NumSlots - 1);
+}
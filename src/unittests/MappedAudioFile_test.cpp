@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "impl/MappedAudioFile.h"
+#include "impl/StreamingAudioWriter.h"
+
+namespace
+{
+constexpr size_t NumChannels{2};
+constexpr size_t NumFrames{1000};
+
+using Bytes = std::vector<uint8_t>;
+
+std::string tempPath(const std::string& name)
+{
+    return ::testing::TempDir() + name;
+}
+
+// the bytes of a valid 16 bit file of a ramp, as StreamingAudioWriter writes it
+Bytes validFile(const AudioFileFormat format)
+{
+    const auto path = tempPath(format == AudioFileFormat::Wave ? "valid.wav" : "valid.aif");
+    StreamingAudioWriter writer;
+    EXPECT_TRUE(writer.open(path, format, 48000, NumChannels, 16));
+    std::vector<float> samples(NumFrames * NumChannels);
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        samples[i] = static_cast<float>(i) / static_cast<float>(samples.size());
+    }
+    EXPECT_TRUE(writer.write(samples.data(), NumFrames));
+    EXPECT_TRUE(writer.close());
+    std::ifstream in(path, std::ios::binary);
+    Bytes bytes{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    std::remove(path.c_str());
+    return bytes;
+}
+
+// offset of the body of the first chunk with id, the chunk header is the 8 bytes before it
+size_t chunkBody(const Bytes& bytes, const char* id)
+{
+    for (size_t i = 12; i + 8 <= bytes.size(); ++i)
+    {
+        if (std::memcmp(bytes.data() + i, id, 4) == 0)
+        {
+            return i + 8;
+        }
+    }
+    ADD_FAILURE() << "no " << id << " chunk";
+    return 0;
+}
+
+void put(Bytes& bytes, const size_t offset, const uint32_t value, const size_t numBytes, const bool littleEndian)
+{
+    for (size_t b = 0; b < numBytes; ++b)
+    {
+        bytes[offset + b] = static_cast<uint8_t>(value >> (8 * (littleEndian ? b : numBytes - 1 - b)));
+    }
+}
+
+// writes bytes to a file and opens it, the file is removed again right away; the mapping keeps it readable
+bool openBytes(MappedAudioFile& file, const Bytes& bytes)
+{
+    const auto path = tempPath("mapped.bin");
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+    const auto result = file.open(path);
+    std::remove(path.c_str());
+    return result;
+}
+
+bool opens(const Bytes& bytes)
+{
+    MappedAudioFile file;
+    const auto result = openBytes(file, bytes);
+    EXPECT_EQ(result, file.isOpen());
+    return result;
+}
+} // namespace
+
+TEST(MappedAudioFileTest, missingAndTinyFiles)
+{
+    MappedAudioFile file;
+    EXPECT_FALSE(file.open(tempPath("does-not-exist.wav")));
+    EXPECT_FALSE(file.isOpen());
+    EXPECT_EQ(file.getNumSamplesPerChannel(), 0u);
+    EXPECT_EQ(file.channel(0).size(), 0u);
+    EXPECT_FALSE(opens(Bytes{}));
+    EXPECT_FALSE(opens(Bytes{'R', 'I', 'F', 'F'}));
+}
+
+TEST(MappedAudioFileTest, truncatedWave)
+{
+    const auto bytes = validFile(AudioFileFormat::Wave);
+    const auto data = chunkBody(bytes, "data");
+    MappedAudioFile file;
+    ASSERT_TRUE(openBytes(file, bytes));
+    ASSERT_EQ(file.getNumSamplesPerChannel(), NumFrames);
+    const auto last = file.sample(1, NumFrames / 2);
+
+    // cut inside the headers: nothing to play
+    for (const size_t size : {size_t{11}, size_t{12}, size_t{30}, data - 4})
+    {
+        EXPECT_FALSE(opens({bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(size)})) << size;
+    }
+    // complete headers without samples, as for a file that was just created
+    ASSERT_TRUE(openBytes(file, {bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(data)}));
+    EXPECT_EQ(file.getNumSamplesPerChannel(), 0u);
+    // cut inside the samples, as for a file that is still being written: the complete frames are there
+    const auto size = data + (NumFrames / 2 + 1) * NumChannels * 2 + 3;
+    ASSERT_TRUE(openBytes(file, {bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(size)}));
+    EXPECT_EQ(file.getNumSamplesPerChannel(), NumFrames / 2 + 1);
+    EXPECT_EQ(file.sample(1, NumFrames / 2), last);
+}
+
+TEST(MappedAudioFileTest, corruptWaveHeaders)
+{
+    const auto valid = validFile(AudioFileFormat::Wave);
+    const auto fmt = chunkBody(valid, "fmt ");
+    const auto data = chunkBody(valid, "data");
+    const auto corrupt = [&valid](const size_t offset, const uint32_t value, const size_t numBytes)
+    {
+        auto bytes = valid;
+        put(bytes, offset, value, numBytes, true);
+        return bytes;
+    };
+    ASSERT_TRUE(opens(valid));
+
+    auto badMagic = valid;
+    std::memcpy(badMagic.data() + 8, "WAVX", 4);
+    EXPECT_FALSE(opens(badMagic));
+    EXPECT_FALSE(opens(corrupt(fmt, 2, 2))) << "ADPCM";
+    EXPECT_FALSE(opens(corrupt(fmt + 2, 0, 2))) << "no channels";
+    EXPECT_FALSE(opens(corrupt(fmt + 4, 0, 4))) << "no sample rate";
+    EXPECT_FALSE(opens(corrupt(fmt + 14, 12, 2))) << "12 bit";
+    EXPECT_FALSE(opens(corrupt(fmt + 14, 0, 2))) << "0 bit";
+    EXPECT_FALSE(opens(corrupt(fmt + 14, 48, 2))) << "48 bit integer";
+    EXPECT_FALSE(opens(corrupt(fmt - 4, 0xFFFFFFF0u, 4))) << "fmt chunk past the end, no data chunk left";
+
+    // a data chunk that claims more than the file holds is cut to the file
+    MappedAudioFile file;
+    ASSERT_TRUE(openBytes(file, corrupt(data - 4, 0xFFFFFFFFu, 4)));
+    EXPECT_EQ(file.getNumSamplesPerChannel(), NumFrames);
+}
+
+TEST(MappedAudioFileTest, truncatedAiff)
+{
+    const auto bytes = validFile(AudioFileFormat::Aiff);
+    const auto ssnd = chunkBody(bytes, "SSND");
+    MappedAudioFile file;
+    ASSERT_TRUE(openBytes(file, bytes));
+    ASSERT_EQ(file.getNumSamplesPerChannel(), NumFrames);
+    EXPECT_EQ(file.getSampleRate(), 48000u);
+
+    for (const size_t size : {size_t{11}, size_t{12}, size_t{30}, ssnd - 4, ssnd + 4})
+    {
+        EXPECT_FALSE(opens({bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(size)})) << size;
+    }
+    const auto size = ssnd + 8 + 10 * NumChannels * 2 + 1;
+    ASSERT_TRUE(openBytes(file, {bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(size)}));
+    EXPECT_EQ(file.getNumSamplesPerChannel(), 10u);
+}
+
+TEST(MappedAudioFileTest, corruptAiffHeaders)
+{
+    const auto valid = validFile(AudioFileFormat::Aiff);
+    const auto comm = chunkBody(valid, "COMM");
+    const auto ssnd = chunkBody(valid, "SSND");
+    const auto corrupt = [&valid](const size_t offset, const uint32_t value, const size_t numBytes)
+    {
+        auto bytes = valid;
+        put(bytes, offset, value, numBytes, false);
+        return bytes;
+    };
+    ASSERT_TRUE(opens(valid));
+
+    auto badMagic = valid;
+    std::memcpy(badMagic.data(), "FORX", 4);
+    EXPECT_FALSE(opens(badMagic));
+    auto badType = valid;
+    std::memcpy(badType.data() + 8, "AIFX", 4);
+    EXPECT_FALSE(opens(badType));
+    EXPECT_FALSE(opens(corrupt(comm, 0, 2))) << "no channels";
+    EXPECT_FALSE(opens(corrupt(comm + 6, 12, 2))) << "12 bit";
+    EXPECT_FALSE(opens(corrupt(comm + 8, 0, 4))) << "no sample rate";
+    EXPECT_FALSE(opens(corrupt(comm + 8, 0xC00E, 2))) << "negative sample rate";
+    EXPECT_FALSE(opens(corrupt(comm + 8, 0x401F, 2))) << "sample rate beyond 32 bit";
+    EXPECT_FALSE(opens(corrupt(comm + 8, 0x7FFF, 2))) << "sample rate NaN or infinite";
+    EXPECT_FALSE(opens(corrupt(ssnd, 0xFFFFFF00u, 4))) << "sample offset past the end";
+
+    // more frames in COMM than the file holds are cut to the file
+    MappedAudioFile file;
+    ASSERT_TRUE(openBytes(file, corrupt(comm + 2, 0x7FFFFFFFu, 4)));
+    EXPECT_EQ(file.getNumSamplesPerChannel(), NumFrames);
+}
+
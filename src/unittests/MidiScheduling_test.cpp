@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "impl/PingSynthExplorerPedal.h"
+
+namespace
+{
+constexpr size_t BlockSize{16};
+constexpr size_t NumBlocks{80};
+using Pedal = PingSynthExplorerPedal<BlockSize>;
+
+struct Event
+{
+    uint64_t time;
+    std::array<uint8_t, 3> data;
+};
+
+std::unique_ptr<Pedal> makePedal(const size_t maxHostBlockSize = 1024)
+{
+    auto pedal = std::make_unique<Pedal>(48000.f, maxHostBlockSize);
+    pedal->setVol(0.f);
+    pedal->setUser1(40.f);
+    pedal->setUser3(50.f);
+    return pedal;
+}
+
+// the left output of a render, events are scheduled before the block that covers their time
+std::vector<float> render(Pedal& pedal, const std::vector<Event>& events)
+{
+    AbacDsp::AudioBuffer<Pedal::NumChannels, BlockSize> in{};
+    AbacDsp::AudioBuffer<Pedal::NumChannels, BlockSize> out{};
+    std::vector<float> left;
+    size_t next = 0;
+    for (size_t block = 0; block < NumBlocks; ++block)
+    {
+        for (; next < events.size() && events[next].time < (block + 1) * BlockSize; ++next)
+        {
+            EXPECT_TRUE(pedal.scheduleMidi(events[next].data.data(), 3, events[next].time));
+        }
+        pedal.processBlock(in, out);
+        for (size_t i = 0; i < BlockSize; ++i)
+        {
+            left.push_back(out(i, 0));
+        }
+    }
+    return left;
+}
+
+std::vector<float> render(const std::vector<Event>& events)
+{
+    auto pedal = makePedal();
+    return render(*pedal, events);
+}
+
+Event noteOn(const uint64_t time, const uint8_t note)
+{
+    return {time, {0x90, note, 100}};
+}
+
+// first sample above a fixed fraction of the peak; the same for a note at any time, only shifted
+size_t onset(const std::vector<float>& signal)
+{
+    float peak = 0.f;
+    for (const auto v : signal)
+    {
+        peak = std::max(peak, std::abs(v));
+    }
+    const auto it =
+        std::find_if(signal.begin(), signal.end(), [peak](const float v) { return std::abs(v) > 0.01f * peak; });
+    return static_cast<size_t>(it - signal.begin());
+}
+} // namespace
+
+TEST(MidiSchedulingTest, noteStartsAtItsSample)
+{
+    const auto reference = onset(render({noteOn(10 * BlockSize, 60)}));
+    ASSERT_LT(reference, NumBlocks * BlockSize);
+    // within a block, at its last sample and in later blocks than the one it is scheduled in
+    for (const uint64_t time : {161u, 167u, 175u, 176u, 203u, 16u * 30u + 9u})
+    {
+        EXPECT_EQ(onset(render({noteOn(time, 60)})), reference + time - 10 * BlockSize) << "note at " << time;
+    }
+}
+
+TEST(MidiSchedulingTest, eventsPastTheBlockWait)
+{
+    // all scheduled up front, each is dispatched in the block that covers its time
+    auto pedal = makePedal();
+    const uint8_t first[3]{0x90, 60, 100};
+    const uint8_t second[3]{0x90, 72, 100};
+    ASSERT_TRUE(pedal->scheduleMidi(first, 3, 100));
+    ASSERT_TRUE(pedal->scheduleMidi(second, 3, 517));
+    const auto together = render(*pedal, {});
+    EXPECT_EQ(together, render({noteOn(100, 60), noteOn(517, 72)}));
+
+    // up to sample 517 only the first note plays
+    const auto firstOnly = render({noteOn(100, 60)});
+    EXPECT_TRUE(std::equal(firstOnly.begin(), firstOnly.begin() + 517, together.begin()));
+    EXPECT_NE(firstOnly, together);
+}
+
+TEST(MidiSchedulingTest, chordsOfMoreThanSixteenNotes)
+{
+    // note-ons in a row are triggered as chords of up to 16 notes, a controller message in between splits
+    // them into single notes; both must trigger the same resonators
+    std::vector<Event> chord;
+    std::vector<Event> single;
+    for (uint8_t n = 0; n < 20; ++n)
+    {
+        chord.push_back(noteOn(40, static_cast<uint8_t>(40 + 2 * n)));
+        single.push_back(noteOn(40, static_cast<uint8_t>(40 + 2 * n)));
+        single.push_back({40, {0xB0, 1, 0}});
+    }
+    const auto all = render(chord);
+    EXPECT_EQ(all, render(single));
+    chord.pop_back();
+    EXPECT_NE(all, render(chord)) << "the 20th note must sound";
+}
+
+TEST(MidiSchedulingTest, fullQueueDispatchesEarly)
+{
+    auto pedal = makePedal(64); // the smallest queue, 1024 events
+    const uint8_t noteOff[3]{0x80, 60, 0};
+    const uint8_t late[3]{0x90, 60, 100};
+    for (size_t k = 0; k < 1023; ++k)
+    {
+        ASSERT_TRUE(pedal->scheduleMidi(noteOff, 3, 1000000));
+    }
+    ASSERT_TRUE(pedal->scheduleMidi(late, 3, 1000000));
+    EXPECT_EQ(pedal->earlyMidiEvents(), 0u);
+    // the next one does not fit: everything queued is dispatched now, in order, and the note-on sounds
+    ASSERT_TRUE(pedal->scheduleMidi(noteOff, 3, 2000000));
+    EXPECT_EQ(pedal->earlyMidiEvents(), 1024u);
+    EXPECT_EQ(render(*pedal, {}), render({noteOn(0, 60)}));
+}
+
+TEST(MidiSchedulingTest, rejectsSysExAndEmptyMessages)
+{
+    auto pedal = makePedal();
+    const uint8_t sysEx[6]{0xF0, 0x7E, 0x7F, 0x09, 0x01, 0xF7};
+    EXPECT_FALSE(pedal->scheduleMidi(sysEx, 6, 0));
+    EXPECT_FALSE(pedal->scheduleMidi(sysEx, 0, 0));
+    EXPECT_EQ(pedal->rejectedMidiEvents(), 2u);
+
+    // two byte messages are padded, a program change does not sound
+    const uint8_t programChange[2]{0xC0, 5};
+    EXPECT_TRUE(pedal->scheduleMidi(programChange, 2, 0));
+    const auto out = render(*pedal, {});
+    EXPECT_EQ(std::count(out.begin(), out.end(), 0.f), static_cast<std::ptrdiff_t>(out.size()));
+    EXPECT_EQ(pedal->rejectedMidiEvents(), 2u);
+}
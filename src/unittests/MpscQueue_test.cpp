@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <array>
+#include <thread>
+#include <vector>
+
+#include "impl/MpscQueue.h"
+
+namespace
+{
+constexpr int NumProducers{4};
+constexpr int NumEvents{50000};
+
+struct Event
+{
+    int producer;
+    int sequence;
+};
+} // namespace
+
+TEST(MpscQueueTest, emptyFullAndWrapAround)
+{
+    MpscQueue<int, 4> queue;
+    EXPECT_EQ(queue.drain([](int) { FAIL() << "empty queue delivered an event"; }), 0u);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(queue.push(i));
+    }
+    EXPECT_FALSE(queue.push(4)) << "a full queue must reject";
+    EXPECT_EQ(queue.droppedCount(), 1u);
+    std::vector<int> drained;
+    EXPECT_EQ(queue.drain([&drained](const int v) { drained.push_back(v); }), 4u);
+    EXPECT_THAT(drained, ::testing::ElementsAre(0, 1, 2, 3));
+
+    // odd batch sizes move head and tail across the end of the ring many times
+    int next = 0;
+    int expected = 0;
+    for (int round = 0; round < 100; ++round)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            ASSERT_TRUE(queue.push(next++));
+        }
+        EXPECT_EQ(queue.drain([&expected](const int v) { EXPECT_EQ(v, expected++); }), 3u);
+    }
+    EXPECT_EQ(expected, 300);
+    EXPECT_EQ(queue.droppedCount(), 1u);
+}
+
+TEST(MpscQueueTest, producerThreads)
+{
+    MpscQueue<Event, 64> queue;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < NumProducers; ++p)
+    {
+        producers.emplace_back(
+            [&queue, p]
+            {
+                for (int i = 0; i < NumEvents; ++i)
+                {
+                    while (!queue.push({p, i}))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+    }
+    // every event arrives once, and those of one producer in the order it pushed them
+    std::array<int, NumProducers> expected{};
+    int received = 0;
+    while (received < NumProducers * NumEvents)
+    {
+        const auto count = queue.drain(
+            [&expected](const Event& e)
+            {
+                ASSERT_GE(e.producer, 0);
+                ASSERT_LT(e.producer, NumProducers);
+                EXPECT_EQ(e.sequence, expected[static_cast<size_t>(e.producer)]++);
+            });
+        received += static_cast<int>(count);
+        if (count == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+    EXPECT_THAT(expected, ::testing::Each(NumEvents));
+    EXPECT_EQ(queue.drain([](const Event&) { FAIL() << "more events than pushed"; }), 0u);
+}
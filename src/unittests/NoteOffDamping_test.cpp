@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "impl/PingSynthExplorerPedal.h"
+
+namespace
+{
+constexpr size_t BlockSize{16};
+constexpr size_t NumBlocks{1500};
+constexpr uint64_t TailStart{(NumBlocks - 300) * BlockSize};
+using Pedal = PingSynthExplorerPedal<BlockSize>;
+
+struct Event
+{
+    uint64_t time;
+    std::array<uint8_t, 3> data;
+};
+
+Event noteOn(const uint64_t time, const uint8_t note)
+{
+    return {time, {0x90, note, 100}};
+}
+
+Event noteOff(const uint64_t time, const uint8_t note)
+{
+    return {time, {0x80, note, 0}};
+}
+
+Event sustain(const uint64_t time, const bool down)
+{
+    return {time, {0xB0, 64, static_cast<uint8_t>(down ? 127 : 0)}};
+}
+
+// the left output, long decay and no overtones so that every note only owns the slots around its own
+std::vector<float> render(const std::vector<Event>& events, const bool damping = true)
+{
+    auto pedal = std::make_unique<Pedal>(48000.f, 1024);
+    pedal->setVol(0.f);
+    pedal->setUser1(80.f);
+    pedal->setUser3(0.f);
+    pedal->setUser4(0.f);
+    pedal->setNoteOffDamping(damping);
+    AbacDsp::AudioBuffer<Pedal::NumChannels, BlockSize> in{};
+    AbacDsp::AudioBuffer<Pedal::NumChannels, BlockSize> out{};
+    std::vector<float> left;
+    size_t next = 0;
+    for (size_t block = 0; block < NumBlocks; ++block)
+    {
+        for (; next < events.size() && events[next].time < (block + 1) * BlockSize; ++next)
+        {
+            EXPECT_TRUE(pedal->scheduleMidi(events[next].data.data(), 3, events[next].time));
+        }
+        pedal->processBlock(in, out);
+        for (size_t i = 0; i < BlockSize; ++i)
+        {
+            left.push_back(out(i, 0));
+        }
+    }
+    return left;
+}
+
+// energy of the difference of two renders from sample start on
+double energyOfDifference(const std::vector<float>& a, const std::vector<float>& b, const uint64_t start)
+{
+    double sum = 0.;
+    for (size_t i = start; i < a.size(); ++i)
+    {
+        const double d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+} // namespace
+
+TEST(NoteOffDampingTest, dampsOnlyTheReleasedNote)
+{
+    const auto low = render({noteOn(0, 48)});
+    const auto both = render({noteOn(0, 48), noteOn(0, 73)});
+    const auto released = render({noteOn(0, 48), noteOn(0, 73), noteOff(800, 73)});
+    const auto ringing = energyOfDifference(both, low, TailStart);
+    ASSERT_GT(ringing, 0.);
+    // the released note has died away, the held one plays on untouched
+    EXPECT_LT(energyOfDifference(released, low, TailStart), 1E-4 * ringing);
+    EXPECT_GT(energyOfDifference(released, both, TailStart), 0.5 * ringing);
+}
+
+TEST(NoteOffDampingTest, noteOffRingsOutWhenDisabled)
+{
+    const auto both = render({noteOn(0, 48), noteOn(0, 73)}, false);
+    EXPECT_EQ(render({noteOn(0, 48), noteOn(0, 73), noteOff(800, 73)}, false), both);
+}
+
+TEST(NoteOffDampingTest, sustainPedalDefersTheDamping)
+{
+    const auto low = render({noteOn(0, 48)});
+    const auto both = render({noteOn(0, 48), noteOn(0, 73)});
+    const auto pedalUp = 640 * BlockSize;
+    const auto held =
+        render({sustain(0, true), noteOn(0, 48), noteOn(0, 73), noteOff(800, 73), sustain(pedalUp, false)});
+    // up to the pedal release the note-off changes nothing, then the note is damped
+    EXPECT_TRUE(std::equal(held.begin(), held.begin() + pedalUp, both.begin()));
+    EXPECT_NE(held, both);
+    EXPECT_LT(energyOfDifference(held, low, TailStart), 1E-4 * energyOfDifference(both, low, TailStart));
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "impl/PingSpread.h"
+
+namespace
+{
+// the grid of PingSynth: MIDI 17 ... 132 at 66 slots per semitone
+constexpr int StepsPerSemitone{66};
+constexpr size_t NumSlots{115 * StepsPerSemitone + 1};
+const float BaseFrequency{440.f * std::pow(2.f, (17 - 69) / 12.f)};
+
+// records the triggered slots, draws the largest random offset
+struct RecordingSink
+{
+    std::vector<size_t>* slots;
+
+    void trigger(const size_t index, float, float) const
+    {
+        slots->push_back(index);
+    }
+
+    [[nodiscard]] float humanRandomness() const noexcept
+    {
+        return 0.f;
+    }
+
+    [[nodiscard]] float uniform() const noexcept
+    {
+        return 0.999f;
+    }
+};
+
+struct Spread
+{
+    std::array<float, NumSlots> frequencies{};
+    FrequencyIndexMapper mapper{BaseFrequency, StepsPerSemitone * 12.f, NumSlots};
+    std::vector<size_t> slots;
+    PingSpread<NumSlots, StepsPerSemitone, RecordingSink> spread{frequencies, mapper, RecordingSink{&slots}};
+
+    Spread()
+    {
+        for (size_t j = 0; j < NumSlots; ++j)
+        {
+            frequencies[j] = BaseFrequency * std::exp2(static_cast<float>(j) / (StepsPerSemitone * 12.f));
+        }
+        spread.setSpread(1.f);
+        spread.setRandomSpread(1.f);
+    }
+};
+} // namespace
+
+TEST(PingSpreadTest, copiesStayOnTheGrid)
+{
+    Spread spread;
+    for (const size_t index : {size_t{0}, size_t{1}, size_t{5}, size_t{200}, NumSlots - 2, NumSlots - 1})
+    {
+        spread.slots.clear();
+        spread.spread.generateSpreads(index, 1.f);
+        for (const auto slot : spread.slots)
+        {
+            EXPECT_LT(slot, NumSlots) << "spread of " << index;
+        }
+    }
+}
+
+TEST(PingSpreadTest, copiesSitOnBothSides)
+{
+    Spread spread;
+    const size_t index{3000};
+    spread.spread.generateSpreads(index, 1.f);
+    ASSERT_EQ(spread.slots.size(), 2u);
+    EXPECT_GT(spread.slots[0], index);
+    EXPECT_LT(spread.slots[1], index);
+
+    // at the bottom only the copy above is left
+    spread.slots.clear();
+    spread.spread.generateSpreads(0, 1.f);
+    ASSERT_EQ(spread.slots.size(), 1u);
+    EXPECT_GT(spread.slots[0], 0u);
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cmath>
+#include <vector>
+
+#include "impl/RandomPool.h"
+
+namespace
+{
+constexpr size_t NumDraws{5000}; // several pool sizes
+
+// uniforms and gaussians interleaved, calling refill() before draw k whenever refillAt(k) holds
+template <typename RefillAt>
+std::vector<float> draw(RandomPool& pool, RefillAt refillAt)
+{
+    std::vector<float> values;
+    values.reserve(NumDraws);
+    for (size_t k = 0; k < NumDraws; ++k)
+    {
+        if (refillAt(k))
+        {
+            pool.refill();
+        }
+        values.push_back(k % 3 == 0 ? pool.gaussian() : pool.uniform());
+    }
+    return values;
+}
+} // namespace
+
+TEST(RandomPoolTest, sequenceDoesNotDependOnRefills)
+{
+    RandomPool onDemand(1234);
+    const auto expected = draw(onDemand, [](size_t) { return false; });
+
+    // at every draw, at irregular intervals that do not line up with the pool or lane sizes, and in bursts
+    RandomPool always(1234);
+    EXPECT_EQ(draw(always, [](size_t) { return true; }), expected);
+    RandomPool irregular(1234);
+    EXPECT_EQ(draw(irregular, [](const size_t k) { return k % 37 == 5 || k % 101 == 0; }), expected);
+    RandomPool bursts(1234);
+    EXPECT_EQ(draw(bursts, [](const size_t k) { return k % 700 < 3; }), expected);
+}
+
+TEST(RandomPoolTest, seedSelectsTheSequence)
+{
+    RandomPool a(1);
+    RandomPool b(2);
+    const auto first = draw(a, [](size_t) { return false; });
+    EXPECT_NE(draw(b, [](size_t) { return false; }), first);
+
+    // reseeding restarts the sequence, whatever was drawn or refilled before
+    b.setSeed(1);
+    EXPECT_EQ(draw(b, [](const size_t k) { return k % 64 == 0; }), first);
+}
+
+TEST(RandomPoolTest, distributions)
+{
+    RandomPool pool;
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    constexpr size_t Count{100000};
+    for (size_t k = 0; k < Count; ++k)
+    {
+        const auto u = pool.uniform();
+        ASSERT_GE(u, 0.f);
+        ASSERT_LT(u, 1.f);
+        const auto g = pool.gaussian();
+        ASSERT_TRUE(std::isfinite(g));
+        sum += g;
+        sumSquares += static_cast<double>(g) * g;
+    }
+    EXPECT_NEAR(sum / Count, 0.0, 0.02);
+    EXPECT_NEAR(sumSquares / Count, 1.0, 0.02);
+}
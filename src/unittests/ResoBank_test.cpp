@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "impl/ResoGenerator.h"
+
+namespace
+{
+constexpr size_t BlockSize{16};
+constexpr int MinMidiNote{21};
+constexpr int StepsPerSemitone{8};
+constexpr size_t NumElements{48 * StepsPerSemitone + 1}; // four octaves
+
+template <bool BankEngine>
+struct Engine
+{
+    ResoGenerator<BlockSize, NumElements, 1, BankEngine> generator{48000.f, MinMidiNote, StepsPerSemitone};
+
+    Engine()
+    {
+        generator.setDecay(0.05f);
+    }
+
+    std::array<float, BlockSize> process()
+    {
+        std::array<float, BlockSize> block{};
+        generator.processBlock(block);
+        return block;
+    }
+};
+} // namespace
+
+TEST(ResoBankTest, matchesBiquadEngine)
+{
+    Engine<false> biquad;
+    Engine<true> bank;
+
+    // single notes, a retrigger of a ringing slot, a delayed and an offset start, a chord
+    const auto trigger = [&](const size_t slot, const float power, const size_t wait, const size_t offset)
+    {
+        biquad.generator.triggerNew(slot, power, wait, offset);
+        bank.generator.triggerNew(slot, power, wait, offset);
+    };
+
+    float peak = 0.f;
+    float maxDifference = 0.f;
+    for (size_t block = 0; block < 3000; ++block)
+    {
+        switch (block)
+        {
+            case 0:
+                trigger(100, 1.f, 0, 0);
+                break;
+            case 40:
+                trigger(200, 0.5f, 2, 7);
+                break;
+            case 400:
+                trigger(100, 0.8f, 0, 3);
+                break;
+            case 1000:
+                for (const size_t slot : {24u, 56u, 80u, 120u, 300u})
+                {
+                    trigger(slot, 0.3f, 0, 11);
+                }
+                break;
+            default:
+                break;
+        }
+        const auto expected = biquad.process();
+        const auto actual = bank.process();
+        for (size_t i = 0; i < BlockSize; ++i)
+        {
+            peak = std::max(peak, std::abs(expected[i]));
+            maxDifference = std::max(maxDifference, std::abs(expected[i] - actual[i]));
+        }
+    }
+    EXPECT_GT(peak, 0.f) << "the triggers should be audible";
+    EXPECT_LT(maxDifference, 1E-3f * peak) << "peak " << peak;
+}
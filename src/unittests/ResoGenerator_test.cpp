@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <initializer_list>
+#include <type_traits>
+#include <vector>
+
+#include "impl/ResoGenerator.h"
+
+namespace
+{
+constexpr size_t BlockSize{16};
+constexpr size_t NumElements{97};
+
+struct Hit
+{
+    size_t slot;
+    float power;
+};
+
+template <bool BankEngine>
+using Generator = ResoGenerator<BlockSize, NumElements, 1, BankEngine>;
+
+template <bool BankEngine>
+void trigger(Generator<BankEngine>& generator, const std::initializer_list<Hit> hits)
+{
+    for (const auto& hit : hits)
+    {
+        generator.triggerNew(hit.slot, hit.power, 0);
+    }
+}
+
+template <bool BankEngine>
+std::vector<float> render(Generator<BankEngine>& generator, const size_t numBlocks)
+{
+    std::vector<float> out;
+    for (size_t block = 0; block < numBlocks; ++block)
+    {
+        std::array<float, BlockSize> samples{};
+        generator.processBlock(samples);
+        out.insert(out.end(), samples.begin(), samples.end());
+    }
+    return out;
+}
+
+float maxDifference(const std::vector<float>& a, const std::vector<float>& b)
+{
+    float result = 0.f;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        result = std::max(result, std::abs(a[i] - b[i]));
+    }
+    return result;
+}
+} // namespace
+
+template <typename Engine>
+class VoiceBudgetTest : public ::testing::Test
+{
+  protected:
+    Generator<Engine::value> generator{48000.f, 21, 4};
+};
+
+using Engines = ::testing::Types<std::false_type, std::true_type>;
+TYPED_TEST_SUITE(VoiceBudgetTest, Engines);
+
+TYPED_TEST(VoiceBudgetTest, capStealsTheQuietest)
+{
+    constexpr bool Bank{TypeParam::value};
+    auto& capped = this->generator;
+    capped.setMaxActiveResonators(3);
+    trigger<Bank>(capped, {{60, 0.05f}, {61, 1.f}, {62, 0.1f}, {63, 0.5f}, {64, 0.02f}, {65, 0.25f}});
+    const auto out = render<Bank>(capped, 1);
+    EXPECT_EQ(capped.activeResonators(), 3u);
+
+    // the three loudest play on as if the others had never been triggered
+    Generator<Bank> loudest{48000.f, 21, 4};
+    trigger<Bank>(loudest, {{61, 1.f}, {63, 0.5f}, {65, 0.25f}});
+    auto expected = render<Bank>(loudest, 200);
+    auto actual = out;
+    const auto rest = render<Bank>(capped, 199);
+    actual.insert(actual.end(), rest.begin(), rest.end());
+    EXPECT_LT(maxDifference(actual, expected), 1E-5f);
+}
+
+TYPED_TEST(VoiceBudgetTest, floorRetiresInaudibleResonators)
+{
+    constexpr bool Bank{TypeParam::value};
+    auto& culled = this->generator;
+    culled.setDecay(0.01f);
+    culled.setAudibilityFloor(-40.f);
+    Generator<Bank> full{48000.f, 21, 4};
+    full.setDecay(0.01f);
+    full.setAudibilityFloor(-200.f);
+    for (auto* target : {&culled, &full})
+    {
+        trigger<Bank>(*target, {{80, 1.f}, {90, 1E-4f}});
+    }
+
+    // the quiet trigger starts below the floor and is retired right away
+    render<Bank>(culled, 1);
+    render<Bank>(full, 1);
+    EXPECT_EQ(culled.activeResonators(), 1u);
+    EXPECT_EQ(full.activeResonators(), 2u);
+
+    // the loud one once it has decayed below the floor, while it still rings without a floor
+    size_t blocks = 1;
+    while (culled.activeResonators() > 0 && blocks < 20000)
+    {
+        render<Bank>(culled, 1);
+        render<Bank>(full, 1);
+        ++blocks;
+    }
+    EXPECT_EQ(culled.activeResonators(), 0u);
+    EXPECT_GE(full.activeResonators(), 1u) << "after " << blocks << " blocks";
+}
+
+TYPED_TEST(VoiceBudgetTest, noiseOfASlotIgnoresTheOthers)
+{
+    // each slot reads its own noise, so with noise on the output still is the sum of the slots played alone
+    constexpr bool Bank{TypeParam::value};
+    std::array<Generator<Bank>, 3> generators{Generator<Bank>{48000.f, 21, 4}, Generator<Bank>{48000.f, 21, 4},
+                                              Generator<Bank>{48000.f, 21, 4}};
+    for (auto& target : generators)
+    {
+        target.setExcitationNoise(0.8f);
+    }
+    auto& alone = generators[0];
+    auto& others = generators[1];
+    auto& together = generators[2];
+    trigger<Bank>(alone, {{60, 1.f}});
+    trigger<Bank>(others, {{40, 1.f}, {80, 0.7f}});
+    trigger<Bank>(together, {{40, 1.f}, {80, 0.7f}, {60, 1.f}});
+    auto sum = render<Bank>(alone, 200);
+    const auto rest = render<Bank>(others, 200);
+    for (size_t i = 0; i < sum.size(); ++i)
+    {
+        sum[i] += rest[i];
+    }
+    EXPECT_LT(maxDifference(render<Bank>(together, 200), sum), 1E-5f);
+
+    // a retrigger of the others in between leaves the slot's noise alone as well
+    trigger<Bank>(alone, {{60, 1.f}});
+    trigger<Bank>(others, {{80, 1.f}});
+    trigger<Bank>(together, {{80, 1.f}, {60, 1.f}});
+    sum = render<Bank>(alone, 200);
+    const auto retriggered = render<Bank>(others, 200);
+    for (size_t i = 0; i < sum.size(); ++i)
+    {
+        sum[i] += retriggered[i];
+    }
+    EXPECT_LT(maxDifference(render<Bank>(together, 200), sum), 1E-5f);
+}
+
+TEST(ResoGeneratorTest, triggerPastTheLastSlotIsDropped)
+{
+    ResoGenerator<BlockSize, NumElements> generator{48000.f, 21, 4};
+    EXPECT_FALSE(generator.triggerNew(NumElements, 1.f, 0));
+    EXPECT_FALSE(generator.triggerNew(~size_t{0}, 1.f, 0));
+    EXPECT_EQ(generator.droppedTriggers(), 2u);
+    EXPECT_TRUE(generator.triggerNew(NumElements - 1, 1.f, 0));
+
+    std::array<float, BlockSize> out{};
+    generator.processBlock(out);
+    EXPECT_EQ(generator.activeResonators(), 1u);
+    EXPECT_EQ(generator.droppedTriggers(), 2u);
+}
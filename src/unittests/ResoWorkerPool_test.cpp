@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#include "impl/ResoWorkerPool.h"
+
+TEST(ResoWorkerPoolTest, everyPartitionRunsOncePerRun)
+{
+    constexpr size_t NumWorkers{3};
+    std::vector<std::atomic<int>> calls(NumWorkers + 1);
+    ResoWorkerPool pool(NumWorkers, [&calls](const size_t band) { calls[band].fetch_add(1); });
+    ASSERT_EQ(pool.numPartitions(), NumWorkers + 1);
+    for (int run = 1; run <= 1000; ++run)
+    {
+        pool.run();
+        for (const auto& count : calls)
+        {
+            ASSERT_EQ(count.load(), run);
+        }
+    }
+}
+
+TEST(ResoWorkerPoolTest, idleWorkersSleep)
+{
+    std::atomic<int> calls{0};
+    ResoWorkerPool pool(3, [&calls](size_t) { calls.fetch_add(1); });
+    pool.run();
+
+    // past the spin budget the workers wait for the next run() without using the CPU
+    const auto cpuBefore = std::clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    const auto cpuSeconds = static_cast<double>(std::clock() - cpuBefore) / CLOCKS_PER_SEC;
+    EXPECT_LT(cpuSeconds, 0.05);
+
+    pool.run();
+    EXPECT_EQ(calls.load(), 8);
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <thread>
+#include <vector>
+
+#include "impl/SpscQueue.h"
+
+TEST(SpscQueueTest, emptyAndFull)
+{
+    SpscQueue<int, 4> queue;
+    EXPECT_EQ(queue.size(), 0u);
+    EXPECT_EQ(queue.front(), nullptr);
+    EXPECT_EQ(queue.drain([](int) { FAIL() << "empty queue delivered an event"; }), 0u);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(queue.push(i));
+    }
+    EXPECT_EQ(queue.size(), 4u);
+    EXPECT_FALSE(queue.push(4)) << "a full queue must reject";
+    EXPECT_FALSE(queue.push(5));
+    EXPECT_EQ(queue.droppedCount(), 2u);
+
+    // the rejected events did not overwrite the queued ones
+    std::vector<int> drained;
+    EXPECT_EQ(queue.drain([&drained](const int v) { drained.push_back(v); }), 4u);
+    EXPECT_THAT(drained, ::testing::ElementsAre(0, 1, 2, 3));
+    EXPECT_EQ(queue.size(), 0u);
+    EXPECT_TRUE(queue.push(6));
+    EXPECT_EQ(queue.droppedCount(), 2u);
+}
+
+TEST(SpscQueueTest, wrapAround)
+{
+    SpscQueue<int, 8> queue;
+    int next = 0;
+    int expected = 0;
+    // odd batch sizes move head and tail across the end of the ring many times
+    for (int round = 0; round < 100; ++round)
+    {
+        for (int i = 0; i < 5; ++i)
+        {
+            ASSERT_TRUE(queue.push(next++));
+        }
+        if (round % 2 == 0)
+        {
+            for (int i = 0; i < 5; ++i)
+            {
+                ASSERT_NE(queue.front(), nullptr);
+                EXPECT_EQ(*queue.front(), expected++);
+                queue.pop();
+            }
+        }
+        else
+        {
+            queue.drain([&expected](const int v) { EXPECT_EQ(v, expected++); });
+        }
+        EXPECT_EQ(queue.size(), 0u);
+    }
+    EXPECT_EQ(expected, 500);
+    EXPECT_EQ(queue.droppedCount(), 0u);
+}
+
+TEST(SpscQueueTest, producerAndConsumerThreads)
+{
+    constexpr int NumEvents{100000};
+    SpscQueue<int, 64> queue;
+    std::thread producer(
+        [&queue]
+        {
+            for (int i = 0; i < NumEvents; ++i)
+            {
+                while (!queue.push(i))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    int expected = 0;
+    while (expected < NumEvents)
+    {
+        if (queue.drain([&expected](const int v) { EXPECT_EQ(v, expected++); }) == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    EXPECT_EQ(queue.size(), 0u);
+}
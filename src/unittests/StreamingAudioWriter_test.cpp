@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "impl/MappedAudioFile.h"
+#include "impl/StreamingAudioWriter.h"
+
+namespace
+{
+constexpr size_t NumChannels{2};
+constexpr size_t NumFrames{20000};
+constexpr size_t BlockFrames{64};
+constexpr uint32_t SampleRate{44100};
+
+// a sine on the left, a ramp over the full range including both ends on the right
+std::vector<float> testSignal()
+{
+    std::vector<float> samples(NumFrames * NumChannels);
+    for (size_t i = 0; i < NumFrames; ++i)
+    {
+        samples[i * NumChannels] = 0.9f * std::sin(static_cast<float>(i) * 0.0648f);
+        samples[i * NumChannels + 1] = -1.f + 2.f * static_cast<float>(i) / static_cast<float>(NumFrames - 1);
+    }
+    return samples;
+}
+
+// what the file stores for v, converted back the way AudioFile reads it
+float quantized(const float v, const AudioFileFormat format, const int bitDepth)
+{
+    using Converter = AudioSampleConverter<float>;
+    switch (bitDepth)
+    {
+        case 16:
+            return Converter::sixteenBitIntToSample(Converter::sampleToSixteenBitInt(v));
+        case 24:
+            return Converter::twentyFourBitIntToSample(Converter::sampleToTwentyFourBitInt(v));
+        default:
+            if (format == AudioFileFormat::Wave)
+            {
+                return v; // 32 bit WAV is float
+            }
+            return Converter::thirtyTwoBitIntToSample(Converter::sampleToThirtyTwoBitInt(v));
+    }
+}
+
+std::string tempPath(const std::string& name)
+{
+    return ::testing::TempDir() + name;
+}
+
+// writes the signal in blocks through a ring much smaller than the file, waiting for the disk thread when full
+bool writeFile(const std::string& path, const AudioFileFormat format, const int bitDepth,
+               const std::vector<float>& samples)
+{
+    StreamingAudioWriter writer;
+    if (!writer.open(path, format, SampleRate, NumChannels, bitDepth, 256))
+    {
+        return false;
+    }
+    for (size_t frame = 0; frame < NumFrames; frame += BlockFrames)
+    {
+        while (!writer.write(samples.data() + frame * NumChannels, std::min(BlockFrames, NumFrames - frame)))
+        {
+            std::this_thread::yield();
+        }
+    }
+    return writer.close();
+}
+} // namespace
+
+struct RoundTrip
+{
+    AudioFileFormat format;
+    int bitDepth;
+    const char* name;
+};
+
+class StreamingAudioWriterRoundTrip : public ::testing::TestWithParam<RoundTrip>
+{
+};
+
+TEST_P(StreamingAudioWriterRoundTrip, readsBackEverySample)
+{
+    const auto [format, bitDepth, name] = GetParam();
+    const auto path = tempPath(name);
+    const auto samples = testSignal();
+    ASSERT_TRUE(writeFile(path, format, bitDepth, samples));
+
+    MappedAudioFile file;
+    ASSERT_TRUE(file.open(path));
+    EXPECT_EQ(file.getFormat(), format);
+    EXPECT_EQ(file.getSampleRate(), SampleRate);
+    EXPECT_EQ(file.getNumChannels(), NumChannels);
+    EXPECT_EQ(file.getBitDepth(), bitDepth);
+    EXPECT_EQ(file.isFloatingPoint(), format == AudioFileFormat::Wave && bitDepth == 32);
+    ASSERT_EQ(file.getNumSamplesPerChannel(), NumFrames);
+    for (size_t i = 0; i < NumFrames; ++i)
+    {
+        for (size_t c = 0; c < NumChannels; ++c)
+        {
+            ASSERT_EQ(file.sample(c, i), quantized(samples[i * NumChannels + c], format, bitDepth))
+                << "frame " << i << " channel " << c;
+        }
+    }
+    file.close();
+    std::remove(path.c_str());
+}
+
+INSTANTIATE_TEST_SUITE_P(Formats, StreamingAudioWriterRoundTrip,
+                         ::testing::Values(RoundTrip{AudioFileFormat::Wave, 16, "roundtrip16.wav"},
+                                           RoundTrip{AudioFileFormat::Wave, 24, "roundtrip24.wav"},
+                                           RoundTrip{AudioFileFormat::Wave, 32, "roundtrip32.wav"},
+                                           RoundTrip{AudioFileFormat::Aiff, 16, "roundtrip16.aif"},
+                                           RoundTrip{AudioFileFormat::Aiff, 24, "roundtrip24.aif"},
+                                           RoundTrip{AudioFileFormat::Aiff, 32, "roundtrip32.aif"}),
+                         [](const auto& paramInfo)
+                         {
+                             auto name = std::string(paramInfo.param.name);
+                             std::replace(name.begin(), name.end(), '.', '_');
+                             return name;
+                         });
+
+TEST(StreamingAudioWriterTest, interleavedViewAndChannelCopy)
+{
+    const auto samples = testSignal();
+
+    // 16 bit WAV data starts at byte 44, the samples are served as stored
+    const auto pcmPath = tempPath("interleaved16.wav");
+    ASSERT_TRUE(writeFile(pcmPath, AudioFileFormat::Wave, 16, samples));
+    MappedAudioFile pcm(pcmPath);
+    const auto stored = pcm.interleaved<int16_t>();
+    ASSERT_EQ(stored.size(), samples.size());
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        ASSERT_EQ(stored[i], AudioSampleConverter<float>::sampleToSixteenBitInt(samples[i])) << i;
+    }
+    EXPECT_TRUE(pcm.interleaved<float>().empty());
+    pcm.close();
+    std::remove(pcmPath.c_str());
+
+    // the float WAV header has an 18 byte fmt chunk like AudioFile's, so its data is not aligned for a view
+    const auto floatPath = tempPath("interleaved32.wav");
+    ASSERT_TRUE(writeFile(floatPath, AudioFileFormat::Wave, 32, samples));
+    MappedAudioFile file(floatPath);
+    EXPECT_TRUE(file.interleaved<float>().empty());
+    std::vector<float> right(NumFrames + 10);
+    EXPECT_EQ(file.channel(1).copyTo(right.data(), 0, right.size()), NumFrames);
+    for (size_t i = 0; i < NumFrames; ++i)
+    {
+        ASSERT_EQ(right[i], samples[i * NumChannels + 1]) << i;
+    }
+    EXPECT_EQ(file.channel(2).size(), 0u);
+    file.close();
+    std::remove(floatPath.c_str());
+}
+
+TEST(StreamingAudioWriterTest, fullRingDropsWholeWrites)
+{
+    const auto path = tempPath("dropped.wav");
+    StreamingAudioWriter writer;
+    ASSERT_TRUE(writer.open(path, AudioFileFormat::Wave, SampleRate, NumChannels, 16, 256));
+    const std::vector<float> block(1000 * NumChannels, 0.5f);
+    EXPECT_FALSE(writer.write(block.data(), 1000)) << "more than the ring holds";
+    EXPECT_EQ(writer.droppedFrames(), 1000u);
+    EXPECT_TRUE(writer.write(block.data(), 100));
+    ASSERT_TRUE(writer.close());
+
+    MappedAudioFile file(path);
+    ASSERT_TRUE(file.isOpen());
+    EXPECT_EQ(file.getNumSamplesPerChannel(), 100u);
+    file.close();
+    std::remove(path.c_str());
+}
+
+TEST(StreamingAudioWriterTest, rejectsUnsupportedFormats)
+{
+    StreamingAudioWriter writer;
+    const auto path = tempPath("rejected.wav");
+    EXPECT_FALSE(writer.open(path, AudioFileFormat::Wave, SampleRate, NumChannels, 8));
+    EXPECT_FALSE(writer.open(path, AudioFileFormat::Wave, SampleRate, 0, 16));
+    EXPECT_FALSE(writer.open(path, AudioFileFormat::NotLoaded, SampleRate, NumChannels, 16));
+    EXPECT_FALSE(writer.isOpen());
+    const float frame[NumChannels]{};
+    EXPECT_FALSE(writer.write(frame, 1));
+    std::remove(path.c_str());
+}